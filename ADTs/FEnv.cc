@@ -20,10 +20,98 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "FEnv.h"
 
 namespace FEnv {
-    vector<NodeData>       nodes;
-    Map<NodeData, int>  uniqueness_table;
+    vector<BinNode>        bins;
+    vector<ITENode>        ites;
+    vector<FANode>         fas;
+    FlatMap<NodeData, FmlWord> uniqueness_table;
 
-    vector<int>            stack;
+    vector<Mark>           stack;
+
+    static bool isLive(const NodeData& node, FmlWord f) { return live(node, Formula(f)); }
+    void purgeStale() { uniqueness_table.filter(isLive); }
+}
+
+
+//=================================================================================================
+// Compaction:
+
+
+// New handle of 'f' (with any flag in bit 2 kept) after renumbering by 'new_index':
+static FmlWord moved(FmlWord w, const vector<int> new_index[3])
+{
+    Formula f((FmlWord)(w & ~(FmlWord)4));
+    if (!compo(f)) return w;
+    assert(new_index[ctag(f)][index(f)] != -1);
+    return (FmlWord)FEnv::Comp_new(ctag(f), new_index[ctag(f)][index(f)], sign(f)) | (w & 4);
+}
+
+
+// Drops every node that is not reachable from a node for which 'root()' is true, and renumbers
+// the rest (in their original order). On return, 'new_index[tag][i]' is the new index of the
+// node of kind 'tag' which had index 'i', or -1 if it was dropped. Handles held by the caller
+// are not updated; maps keyed by formulas must be renumbered (see 'CompMap::renumber()').
+// There must be no active 'push()'.
+void FEnv::compact(bool (*root)(Formula), vector<int> new_index[3])
+{
+    assert(stack.size() == 0);
+
+    // Mark:
+    vector<Formula> todo;
+    for (int k = 0; k < 3; k++){
+        new_index[k].assign(nodeCount(k), -1);
+        for (int i = 0; i < nodeCount(k); i++)
+            if (root(Comp_new(k, i)))
+                todo.push_back(Comp_new(k, i));
+    }
+    while (todo.size() > 0){
+        Formula f = todo.back(); todo.pop_back();
+        if (!compo(f) || new_index[ctag(f)][index(f)] != -1) continue;
+        new_index[ctag(f)][index(f)] = 0;
+        if (Bin_p(f))
+            todo.push_back(unsign(left(f))), todo.push_back(unsign(right(f)));
+        else if (ITE_p(f))
+            todo.push_back(unsign(cond(f))), todo.push_back(unsign(tt(f))), todo.push_back(unsign(ff(f)));
+        else
+            todo.push_back(unsign(FA_x(f))), todo.push_back(unsign(FA_y(f))), todo.push_back(unsign(FA_c(f)));
+    }
+    int n_kept[3] = { 0, 0, 0 };
+    for (int k = 0; k < 3; k++)
+        for (int i = 0; i < (int)new_index[k].size(); i++)
+            if (new_index[k][i] != -1) new_index[k][i] = n_kept[k]++;
+
+    // Move the surviving records down, and rebuild the uniqueness table from them:
+    uniqueness_table.clear();
+    for (int i = 0; i < (int)bins.size(); i++){
+        int j = new_index[tag_Bin][i];
+        if (j == -1) continue;
+        BinNode& n = bins[j] = bins[i];
+        n.left  = moved(n.left , new_index);
+        n.right = moved(n.right, new_index);
+        uniqueness_table.set(NodeData(n.left, n.right, 4), Comp_new(tag_Bin, j));
+    }
+    for (int i = 0; i < (int)ites.size(); i++){
+        int j = new_index[tag_ITE][i];
+        if (j == -1) continue;
+        ITENode& n = ites[j] = ites[i];
+        n.cond = moved(n.cond, new_index);
+        n.tt   = moved(n.tt  , new_index);
+        n.ff   = moved(n.ff  , new_index);
+        uniqueness_table.set(NodeData(n.cond, n.tt, n.ff), Comp_new(tag_ITE, j));
+    }
+    for (int i = 0; i < (int)fas.size(); i++){
+        int j = new_index[tag_FA][i];
+        if (j == -1) continue;
+        FANode& n = fas[j] = fas[i];
+        n.x = moved(n.x, new_index);
+        n.y = moved(n.y, new_index);
+        n.c = moved(n.c, new_index);
+        uniqueness_table.set(NodeData(n.x | 4, n.y, n.c), Comp_new(tag_FA, j));
+    }
+
+    // Give the memory back (the arrays may have grown far beyond what survives):
+    vector<BinNode>(bins.begin(), bins.begin() + n_kept[tag_Bin]).swap(bins);
+    vector<ITENode>(ites.begin(), ites.begin() + n_kept[tag_ITE]).swap(ites);
+    vector<FANode> (fas .begin(), fas .begin() + n_kept[tag_FA ]).swap(fas);
 }
 
 
@@ -36,97 +36,137 @@ SOFTWARE.
 #define FML Formula
 #define UNDEF_INDEX -2
 
+#include "FlatMap.h"
 #include "Map.h"
 #include "VecMaps.h"
 enum Op { op_And, op_Equiv };
 
 //-------------------------------------------------------------------------------------------------
 
-// Layout: 31..4=index, 3=sign, 2=compo, 1..0=unused
+#ifndef tag_Atom
+#define tag_Atom (-1)
+#endif
+#define tag_Bin 0
+#define tag_ITE 1
+#define tag_FA 2
+
+// Handles are 32 bits unless built with 'FORMULA64'. The index then has 28 bits, which limits each
+// kind of node (and the variables) to 2^27 entries, or 2^30 with 64-bit handles (where 'index()'
+// and 'sindex()' still have to fit in an 'int').
+#ifdef FORMULA64
+typedef uint64 FmlWord;
+typedef int64 FmlSWord;
+#else
+typedef unsigned FmlWord;
+typedef int FmlSWord;
+#endif
+
+// Layout: N..4=index, 3=sign, 2=unused, 1..0=kind (0 for atoms, 'tag'+1 for composite nodes)
+//
+// The index of a composite node is its position in the array of its own kind (see below). Bit 2
+// is free in every handle, so node records use it for their flags.
 class FML {
-  unsigned data;
+  FmlWord data;
 
  public:
-  FML(unsigned d) : data(d) {}
-  FML(bool compo = false, int index = UNDEF_INDEX, bool sign = false)
-      : data(((unsigned)index << 4) | ((unsigned)sign << 3) |
-             ((unsigned)compo << 2)) {}
-  operator unsigned(void) const { return data; }
+  FML(FmlWord d) : data(d) {}
+  FML(int kind = 0, int index = UNDEF_INDEX, bool sign = false)
+      : data(((FmlWord)index << 4) | ((FmlWord)sign << 3) | (FmlWord)kind) {}
+  operator FmlWord(void) const { return data; }
 };
 
 //-------------------------------------------------------------------------------------------------
 
 namespace ENV {
+// Node records, one dense array per kind. Children are stored as handles, flags in their bit 2.
+struct BinNode {  // op(0x4 in 'left'), left, right  (8 bytes)
+  FmlWord left;
+  FmlWord right;
+};
+struct ITENode {  // cond, tt, ff
+  FmlWord cond;
+  FmlWord tt;
+  FmlWord ff;
+};
+struct FANode {  // isCarry(0x4 in 'y'), x, y, c
+  FmlWord x;
+  FmlWord y;
+  FmlWord c;
+};
+
+extern vector<BinNode> bins;
+extern vector<ITENode> ites;
+extern vector<FANode> fas;
+
+// Key of the uniqueness table. Bit 2 marks the kind where no record keeps a flag: 'data2' of
+// AND nodes, 'data0' of full-adders (see 'Bin_newData()' etc.).
 struct NodeData {
-  unsigned data0;
-  unsigned data1;
-  unsigned data2;
+  FmlWord data0;
+  FmlWord data1;
+  FmlWord data2;
 
   NodeData(){
     data0= data1= data2=0;
   }
-  NodeData(unsigned d0, unsigned d1, unsigned d2)
+  NodeData(FmlWord d0, FmlWord d1, FmlWord d2)
       : data0(d0), data1(d1), data2(d2) {}
-  //      unsigned hash(void) const { return data0 ^ data1 ^ data2; }
+  int tag(void) const {
+    return (data2 & 4) ? tag_Bin : (data0 & 4) ? tag_FA : tag_ITE;
+  }
+  // (all three words go through a multiply so that nodes differing only in one child don't collide)
   unsigned hash(void) const {
-    return data0 ^ ((data1 << 16) | (data1 >> 16)) ^ data2;
+    uint64 h = (data0 * 0x9E3779B97F4A7C15ULL) ^ data1;
+    h = (h * 0xC2B2AE3D27D4EB4FULL) ^ data2;
+    h *= 0x165667B19E3779F9ULL;
+    return (unsigned)(h >> 32);
   }
   bool operator==(const NodeData& other) const {
     return data0 == other.data0 && data1 == other.data1 && data2 == other.data2;
   }
 };
 
-extern vector<NodeData> nodes;
-extern Map<NodeData, int> uniqueness_table;
+extern FlatMap<NodeData, FmlWord> uniqueness_table;
 }
 
 //-------------------------------------------------------------------------------------------------
 
-macro bool operator==(FML f, FML g) { return (unsigned)f == (unsigned)g; }
-macro bool operator!=(FML f, FML g) { return (unsigned)f != (unsigned)g; }
-macro bool operator<(FML f, FML g) { return (unsigned)f < (unsigned)g; }
+macro bool operator==(FML f, FML g) { return (FmlWord)f == (FmlWord)g; }
+macro bool operator!=(FML f, FML g) { return (FmlWord)f != (FmlWord)g; }
+macro bool operator<(FML f, FML g) { return (FmlWord)f < (FmlWord)g; }
 template <>
 struct Hash<FML> {
-  unsigned operator()(FML f) const { return (unsigned)f; }
+  unsigned operator()(FML f) const { return (unsigned)((FmlWord)f ^ ((FmlWord)f >> 16 >> 16)); }
 };
 
-macro FML neg(FML f) { return FML((unsigned)f ^ 8); }
-macro FML unsign(FML f) { return FML((unsigned)f & ~8); }
+macro FML neg(FML f) { return FML((FmlWord)f ^ 8); }
+macro FML unsign(FML f) { return FML((FmlWord)f & ~8); }
 macro FML id(FML f, bool sign) {
-  return FML((unsigned)f ^ ((unsigned)sign << 3));
+  return FML((FmlWord)f ^ ((FmlWord)sign << 3));
 }
 
-macro bool sign(FML f) { return ((unsigned)f & 8) != 0; }
-macro bool compo(FML f) { return ((unsigned)f & 4) != 0; }
-macro int index(FML f) { return (int)(unsigned)f >> 4; }
-macro int sindex(FML f) { return (int)(unsigned)f >> 3; }
+macro bool sign(FML f) { return ((FmlWord)f & 8) != 0; }
+macro bool compo(FML f) { return ((FmlWord)f & 3) != 0; }
+macro int index(FML f) { return (int)((FmlSWord)(FmlWord)f >> 4); }
+macro int sindex(FML f) { return (int)((FmlSWord)(FmlWord)f >> 3); }
 
-macro FML FormulaC(int index, bool sign = false) {
-  return FML(true, index, sign);
+macro FML FormulaC(int tag, int index, bool sign = false) {
+  return FML(tag + 1, index, sign);
 }
 macro FML FormulaA(int index, bool sign = false) {
-  return FML(false, index, sign);
+  return FML(0, index, sign);
 }
 namespace ENV {
-macro FML Comp_new(int index, bool sign = false) {
-  return FML(true, index, sign);
+macro FML Comp_new(int tag, int index, bool sign = false) {
+  return FML(tag + 1, index, sign);
 }
 macro FML Atom_new(int index, bool sign = false) {
-  return FML(false, index, sign);
+  return FML(0, index, sign);
 }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-#ifndef tag_Atom
-#define tag_Atom (-1)
-#endif
-#define tag_Bin 0
-#define tag_ITE 1
-#define tag_FA 2
-
-macro int ctag(FML f) { return (int)(ENV::nodes[index(f)].data0 & 3); }
-macro int ctag(int index) { return (int)(ENV::nodes[index].data0 & 3); }
+macro int ctag(FML f) { return (int)((FmlWord)f & 3) - 1; }
 macro int tag(FML f) { return compo(f) ? ctag(f) : tag_Atom; }
 
 macro bool Atom_p(FML f) { return !compo(f); }
@@ -136,65 +176,94 @@ macro bool FA_p(FML f) { return tag(f) == tag_FA; }
 
 //-------------------------------------------------------------------------------------------------
 
-macro Op op(FML f) { return (Op)(ENV::nodes[index(f)].data1 & 0x3); }
-macro FML left(FML f) { return (FML)(ENV::nodes[index(f)].data1 & 0xFFFFFFFC); }
-macro FML right(FML f) {
-  return (FML)(ENV::nodes[index(f)].data2 & 0xFFFFFFFC);
-}
-macro FML cond(FML f) { return (FML)(ENV::nodes[index(f)].data0 & 0xFFFFFFFC); }
-macro FML tt(FML f) { return (FML)(ENV::nodes[index(f)].data1 & 0xFFFFFFFC); }
-macro FML ff(FML f) { return (FML)(ENV::nodes[index(f)].data2 & 0xFFFFFFFC); }
-macro bool isCarry(FML f) { return (bool)(ENV::nodes[index(f)].data1 & 0x1); }
-macro FML FA_x(FML f) { return (FML)(ENV::nodes[index(f)].data0 & 0xFFFFFFFC); }
-macro FML FA_y(FML f) { return (FML)(ENV::nodes[index(f)].data1 & 0xFFFFFFFC); }
-macro FML FA_c(FML f) { return (FML)(ENV::nodes[index(f)].data2 & 0xFFFFFFFC); }
+macro Op op(FML f) { return (Op)((ENV::bins[index(f)].left >> 2) & 1); }
+macro FML left(FML f) { return (FML)(ENV::bins[index(f)].left & ~(FmlWord)4); }
+macro FML right(FML f) { return (FML)ENV::bins[index(f)].right; }
+macro FML cond(FML f) { return (FML)ENV::ites[index(f)].cond; }
+macro FML tt(FML f) { return (FML)ENV::ites[index(f)].tt; }
+macro FML ff(FML f) { return (FML)ENV::ites[index(f)].ff; }
+macro bool isCarry(FML f) { return (ENV::fas[index(f)].y & 4) != 0; }
+macro FML FA_x(FML f) { return (FML)ENV::fas[index(f)].x; }
+macro FML FA_y(FML f) { return (FML)(ENV::fas[index(f)].y & ~(FmlWord)4); }
+macro FML FA_c(FML f) { return (FML)ENV::fas[index(f)].c; }
 
 //-------------------------------------------------------------------------------------------------
 
 macro ENV::NodeData Bin_newData(Op op, FML left, FML right) {
 #ifdef PARANOID
-  assert((unsigned)op < 0x4U);
-  assert(((unsigned)left & 0x3) == 0);
-  assert(((unsigned)right & 0x3) == 0);
+  assert((FmlWord)op < 0x2U);
+  assert(((FmlWord)left & 0x4) == 0);
+  assert(((FmlWord)right & 0x4) == 0);
 #endif
-  return ENV::NodeData(tag_Bin, (unsigned)op | (unsigned)left, (unsigned)right);
+  return ENV::NodeData((FmlWord)left | ((FmlWord)op << 2), (FmlWord)right, 4);
 }
 
 macro ENV::NodeData ITE_newData(FML cond, FML tt, FML ff) {
 #ifdef PARANOID
-  assert(((unsigned)cond & 0x3) == 0);
-  assert(((unsigned)tt & 0x3) == 0);
-  assert(((unsigned)ff & 0x3) == 0);
+  assert(((FmlWord)cond & 0x4) == 0);
+  assert(((FmlWord)tt & 0x4) == 0);
+  assert(((FmlWord)ff & 0x4) == 0);
 #endif
-  return ENV::NodeData(tag_ITE | (unsigned)cond, (unsigned)tt, (unsigned)ff);
+  return ENV::NodeData((FmlWord)cond, (FmlWord)tt, (FmlWord)ff);
 }
 
 macro ENV::NodeData FA_newData(bool isCarry, FML FA_x, FML FA_y, FML FA_c) {
 #ifdef PARANOID
-  assert((unsigned)isCarry < 0x2U);
-  assert(((unsigned)FA_x & 0x3) == 0);
-  assert(((unsigned)FA_y & 0x3) == 0);
-  assert(((unsigned)FA_c & 0x3) == 0);
+  assert(((FmlWord)FA_x & 0x4) == 0);
+  assert(((FmlWord)FA_y & 0x4) == 0);
+  assert(((FmlWord)FA_c & 0x4) == 0);
 #endif
-  return ENV::NodeData(tag_FA | (unsigned)FA_x,
-                       (unsigned)isCarry | (unsigned)FA_y, (unsigned)FA_c);
+  return ENV::NodeData((FmlWord)FA_x | 4, (FmlWord)FA_y | ((FmlWord)isCarry << 2),
+                       (FmlWord)FA_c);
 }
 
 namespace ENV {
-macro FML new_helper(ENV::NodeData node, bool sign) {
-  int index = ENV::nodes.size();
-  ENV::nodes.push_back(node);
-  return ENV::Comp_new(index, sign);
+// Appends the record for 'node' to the array of its kind:
+macro FML new_helper(const NodeData& node, bool sign) {
+  int index;
+  switch (node.tag()) {
+    case tag_Bin: {
+      BinNode n = {node.data0, node.data1};
+      index = bins.size(), bins.push_back(n);
+      return Comp_new(tag_Bin, index, sign);
+    }
+    case tag_ITE: {
+      ITENode n = {node.data0, node.data1, node.data2};
+      index = ites.size(), ites.push_back(n);
+      return Comp_new(tag_ITE, index, sign);
+    }
+    default: {
+      FANode n = {node.data0 & ~(FmlWord)4, node.data1, node.data2};
+      index = fas.size(), fas.push_back(n);
+      return Comp_new(tag_FA, index, sign);
+    }
+  }
 }
 
-macro FML newS_helper(ENV::NodeData node, bool sign) {
-  int index;
-  if (!uniqueness_table.peek(node, index)) {
-    index = ENV::nodes.size();
-    ENV::nodes.push_back(node);
-    uniqueness_table.set(node, index);
+// An entry of 'uniqueness_table' is only valid while the node it points at is still 'node'.
+// 'FEnv::pop()' leaves its entries behind; they are overwritten here, or purged by 'pop()'
+// once they outnumber the live nodes.
+macro bool live(const NodeData& node, FML f) {
+  int i = index(f);
+  switch (node.tag()) {
+    case tag_Bin:
+      return i < (int)bins.size() && bins[i].left == node.data0 && bins[i].right == node.data1;
+    case tag_ITE:
+      return i < (int)ites.size() && ites[i].cond == node.data0 && ites[i].tt == node.data1 &&
+             ites[i].ff == node.data2;
+    default:
+      return i < (int)fas.size() && fas[i].x == (node.data0 & ~(FmlWord)4) && fas[i].y == node.data1 &&
+             fas[i].c == node.data2;
   }
-  return ENV::Comp_new(index, sign);
+}
+
+macro FML newS_helper(const NodeData& node, bool sign) {
+  FmlWord f;
+  if (!uniqueness_table.peek(node, f) || !live(node, FML(f))) {
+    f = new_helper(node, false);
+    uniqueness_table.set(node, f);
+  }
+  return id(FML(f), sign);
 }
 }
 
@@ -263,22 +332,52 @@ struct AtomMap : public VecMap<T> {
 }
 
 namespace ENV {
+macro int nodeCount(int tag) {
+  return tag == tag_Bin ? bins.size() : tag == tag_ITE ? ites.size() : fas.size();
+}
+
+// Keeps one map per kind of node, each offset by the number of nodes of that kind that existed
+// when the map was created.
 template <class T, bool sgn = false>
-class CompMap : DeckMap<T> {
-  int offset;
+class CompMap {
+  DeckMap<T> maps[3];
+  int offset[3];
+  T T_null;
+
+  int key(FML f) const {
+    return (sgn ? sindex(f) : ::index(f)) - offset[ctag(f)];
+  }
 
  public:
   typedef FML Key;
   typedef T Datum;
-  CompMap(void) : DeckMap<T>(), offset(ENV::nodes.size()) {}
-  CompMap(T null) : DeckMap<T>(null), offset(ENV::nodes.size()) {}
-  T at(FML f) {
-    return DeckMap<T>::at((sgn ? sindex(f) : ::index(f)) - offset);
+  CompMap(void) : T_null() {
+    for (int k = 0; k < 3; k++) offset[k] = nodeCount(k) << (int)sgn;
   }
-  void set(FML f, T value) {
-    DeckMap<T>::set((sgn ? sindex(f) : ::index(f)) - offset, value);
+  CompMap(T null) : T_null(null) {
+    for (int k = 0; k < 3; k++)
+      maps[k] = DeckMap<T>(null), offset[k] = nodeCount(k) << (int)sgn;
+  }
+  T at(FML f) { return maps[ctag(f)].at(key(f)); }
+  void set(FML f, T value) { maps[ctag(f)].set(key(f), value); }
+  void clear() {
+    for (int k = 0; k < 3; k++) maps[k].clear();
+  }
+
+  // Moves every entry to the node's index after 'FEnv::compact()' (see there for 'new_index'):
+  void renumber(const vector<int> new_index[3]) {
+    for (int k = 0; k < 3; k++) {
+      DeckMap<T> m(T_null);
+      for (int i = 0; i < (int)new_index[k].size(); i++) {
+        if (new_index[k][i] == -1) continue;
+        for (int s = 0; s <= (int)sgn; s++)
+          m.set((new_index[k][i] << (int)sgn) + s,
+                maps[k].at((i << (int)sgn) + s - offset[k]));
+      }
+      maps[k] = m;
+      offset[k] = 0;
+    }
   }
-  void clear() { DeckMap<T>::clear(); }
 };
 
 template <class T, bool sgn = false>
@@ -410,24 +509,39 @@ macro Formula ITE(Formula c, Formula t, Formula f) {
 bool eval(Formula f, AMap<char>& values);
 
 namespace FEnv {
-extern vector<int> stack;
-macro void init() {
-  nodes.clear();
+struct Mark {  // (sizes of the node arrays at a 'push()')
+  int n_bins, n_ites, n_fas;
+};
+extern vector<Mark> stack;
+macro int size() { return bins.size() + ites.size() + fas.size(); }
+macro void clear() {
+  bins.clear();
+  ites.clear();
+  fas.clear();
   uniqueness_table.clear();
+}
+macro void init() {
+  clear();
   stack.clear();
 }
-macro void clear() {
-  nodes.clear();
-  uniqueness_table.clear();
+void purgeStale();
+void compact(bool (*root)(FML), vector<int> new_index[3]);
+macro void push() {
+  Mark m = {(int)bins.size(), (int)ites.size(), (int)fas.size()};
+  stack.push_back(m);
 }
-macro void push() { stack.push_back(nodes.size()); }
-macro void pop() {
-  while (nodes.size() > stack.back())
-    uniqueness_table.remove(nodes.back()), nodes.pop_back();
+macro void pop() {  // (undoes everything since the matching 'push()' in constant time)
+  bins.resize(stack.back().n_bins);
+  ites.resize(stack.back().n_ites);
+  fas.resize(stack.back().n_fas);
+  stack.pop_back();
+  if (uniqueness_table.size() > 2 * size() + 1024) purgeStale();
 }
 macro void keep() { stack.pop_back(); }
 macro int topSize() {
-  return (stack.size() == 0) ? nodes.size() : nodes.size() - stack.back();
+  if (stack.size() == 0) return size();
+  const Mark& m = stack.back();
+  return size() - (m.n_bins + m.n_ites + m.n_fas);
 }
 }
 
@@ -18,6 +18,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 **************************************************************************************************/
 
 #include "File.h"
+#include <sys/mman.h>
 
 
 void File::open(int file_descr, FileMode m, bool own)
@@ -99,6 +100,34 @@ int64 File::tell(void)
 }
 
 
+//=================================================================================================
+// MappedFile:
+
+
+void MappedFile::open(cchar* name)
+{
+    close();
+    struct stat st;
+    fd = open64(name, O_RDONLY);
+    if (fd == -1) return;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0){ close(); return; }
+    size_ = (size_t)st.st_size;
+    void* mem = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED){ close(); return; }
+    data_ = (cchar*)mem;
+    // (advice values are not flags; each needs a call of its own)
+    if (madvise(mem, size_, MADV_SEQUENTIAL) != 0 || madvise(mem, size_, MADV_WILLNEED) != 0){ close(); return; }
+}
+
+
+void MappedFile::close(void)
+{
+    if (data_ != NULL) munmap((void*)data_, size_), data_ = NULL;
+    if (fd != -1) ::close(fd), fd = -1;
+    size_ = 0;
+}
+
+
 //=================================================================================================
 // Marshaling:
 
@@ -136,7 +165,8 @@ void putUInt(File& out, uint64 val)
 }
 
 
-uint64 getUInt(File& in)    // Returns 0 at end-of-file.
+template<class R>
+static uint64 getUInt_(R& in)
 {
     uint byte0, byte1, byte2, byte3, byte4, byte5, byte6, byte7;
     byte0 = in.getChar();
@@ -173,3 +203,15 @@ uint64 getUInt(File& in)    // Returns 0 at end-of-file.
         assert(false);
     }
 }
+
+
+uint64 getUInt(File& in)        // Returns 0 at end-of-file.
+{
+    return getUInt_(in);
+}
+
+
+uint64 getUInt(MemReader& in)   // Returns 0 at end of memory region.
+{
+    return getUInt_(in);
+}
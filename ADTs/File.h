@@ -161,6 +161,51 @@ class File {
   int64 tell(void);
 };
 
+//=================================================================================================
+// A read-only memory mapping of a whole file:
+
+// Only works for regular files; 'null()' is TRUE if the file could not be
+// mapped (pipes, devices, empty files...) or the kernel rejected the access
+// hints (sequential, needed soon).
+class MappedFile {
+  int fd;
+  cchar* data_;
+  size_t size_;
+
+ public:
+  MappedFile(cchar* name) : fd(-1), data_(NULL), size_(0) { open(name); }
+  ~MappedFile(void) { close(); }
+
+  void open(cchar* name);
+  void close(void);
+
+  bool null(void) const { return data_ == NULL; }
+  cchar* data(void) const { return data_; }
+  size_t size(void) const { return size_; }
+};
+
+//=================================================================================================
+// Sequential reading of a memory region (e.g. a 'MappedFile'):
+
+class MemReader {
+  const uchar* ptr;
+  const uchar* end;
+
+ public:
+  MemReader(cchar* data, size_t size)
+      : ptr((const uchar*)data), end((const uchar*)data + size) {}
+
+  int getChar(void) { return (ptr < end) ? *ptr++ : EOF; }
+  bool eof(void) const { return ptr >= end; }
+
+  cchar* getChars(size_t n) {  // Skips 'n' bytes and returns a pointer to them
+                               // (NULL if fewer bytes are left).
+    if ((size_t)(end - ptr) < n) return NULL;
+    ptr += n;
+    return (cchar*)ptr - n;
+  }
+};
+
 //=================================================================================================
 // Some nice helper functions:
 
@@ -175,5 +220,8 @@ macro int64 decode64(uint64 val) {
 macro void putInt(File& out, int64 val) { putUInt(out, encode64(val)); }
 macro uint64 getInt(File& in) { return decode64(getUInt(in)); }
 
+uint64 getUInt(MemReader& in);
+macro int64 getInt(MemReader& in) { return decode64(getUInt(in)); }
+
 //=================================================================================================
 #endif
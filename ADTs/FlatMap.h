@@ -0,0 +1,262 @@
+/***************************************************************************************[FlatMap.h]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and
+associated documentation files (the "Software"), to deal in the Software without
+restriction,
+including without limitation the rights to use, copy, modify, merge, publish,
+distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom
+the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************************************/
+
+#ifndef FlatMap_h
+#define FlatMap_h
+
+#include "Hash_standard.h"
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//=================================================================================================
+// FlatMap -- open-addressing hash table with keys and data stored inline.
+//
+// Slots are grouped 16 at a time. Every slot has a control byte: 'FlatMap_Empty', 'FlatMap_Deleted'
+// or the low 7 bits of the key's hash. A lookup compares the 7-bit tag against a whole group at
+// once (with SSE2 where available) and only touches the keys whose tag matches. Groups are probed
+// triangularly; a lookup stops at the first group that has an empty slot. The capacity is a power
+// of two. Supports the same 'peek()'/'set()'/'remove()' interface as 'Map'.
+
+#define FlatMap_Group 16
+#define FlatMap_Empty ((signed char)-128)
+#define FlatMap_Deleted ((signed char)-2)
+
+template <class K, class D, class Par = Hash_params<K> >
+class FlatMap {
+  struct Slot {
+    K key;
+    D datum;
+  };
+
+  signed char* ctrl;  // One control byte per slot.
+  Slot* slots;
+  uint mask;    // Number of groups minus one.
+  int nelems;   // Full slots.
+  int nused;    // Full or deleted slots.
+  int max_used; // Rehash when 'nused' reaches this.
+
+  // Statistics:
+  mutable uint64 n_lookups;
+  mutable uint64 n_probes;  // Groups visited by all lookups.
+  mutable int max_probe;    // Longest probe sequence seen (in groups).
+  int max_elems;            // Largest size the table has had.
+
+  //---------------------------------------------------------------------------------------------
+
+  // 'Par::hash()' is often weak in its low bits; spread it before using it for position and tag.
+  static uint mix(uint h) {
+    uint64 x = (uint64)h * 0x9E3779B97F4A7C15ULL;
+    return (uint)(x >> 32) ^ (uint)x;
+  }
+
+  // Bit 'i' is set if the control byte of slot 'i' in the group equals 'tag':
+  static uint match(const signed char* g, signed char tag) {
+#ifdef __SSE2__
+    __m128i grp = _mm_loadu_si128((const __m128i*)g);
+    return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(grp, _mm_set1_epi8(tag)));
+#else
+    uint ret = 0;
+    for (int i = 0; i < FlatMap_Group; i++)
+      if (g[i] == tag) ret |= 1u << i;
+    return ret;
+#endif
+  }
+
+  // Bit 'i' is set if slot 'i' in the group is empty or deleted (the only negative control bytes):
+  static uint matchFree(const signed char* g) {
+#ifdef __SSE2__
+    return (uint)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+#else
+    uint ret = 0;
+    for (int i = 0; i < FlatMap_Group; i++)
+      if (g[i] < 0) ret |= 1u << i;
+    return ret;
+#endif
+  }
+
+  static int firstBit(uint bits) { return __builtin_ctz(bits); }
+
+  void init(uint n_groups) {
+    mask = n_groups - 1;
+    int cap = n_groups * FlatMap_Group;
+    ctrl = new signed char[cap];
+    memset(ctrl, FlatMap_Empty, cap);
+    slots = new Slot[cap];
+    nelems = 0;
+    nused = 0;
+    max_used = cap - cap / 8;
+  }
+
+  void dispose(void) {
+    delete[] ctrl;
+    delete[] slots;
+  }
+
+  // Returns the slot index of 'key', or -1 if not present.
+  int find(const K& key) const {
+    uint h = mix(Par::hash(key));
+    signed char tag = (signed char)(h & 0x7F);
+    uint g = (h >> 7) & mask;
+    int probe = 1;
+    n_lookups++;
+    for (;;) {
+      const signed char* grp = &ctrl[g * FlatMap_Group];
+      for (uint bits = match(grp, tag); bits != 0; bits &= bits - 1) {
+        int i = g * FlatMap_Group + firstBit(bits);
+        if (Par::equal(slots[i].key, key)) {
+          n_probes += probe;
+          if (probe > max_probe) max_probe = probe;
+          return i;
+        }
+      }
+      if (match(grp, FlatMap_Empty) != 0) {
+        n_probes += probe;
+        if (probe > max_probe) max_probe = probe;
+        return -1;
+      }
+      g = (g + probe) & mask;  // (triangular probing visits every group)
+      probe++;
+    }
+  }
+
+  // Inserts 'key' (which must not be present) without checking the load.
+  void insert(const K& key, const D& datum) {
+    uint h = mix(Par::hash(key));
+    uint g = (h >> 7) & mask;
+    for (int probe = 1;; probe++) {
+      uint bits = matchFree(&ctrl[g * FlatMap_Group]);
+      if (bits != 0) {
+        int i = g * FlatMap_Group + firstBit(bits);
+        if (ctrl[i] == FlatMap_Empty) nused++;
+        ctrl[i] = (signed char)(h & 0x7F);
+        slots[i].key = key;
+        slots[i].datum = datum;
+        nelems++;
+        return;
+      }
+      g = (g + probe) & mask;
+    }
+  }
+
+  // Rebuilds the table, dropping deleted slots, at the size that leaves it less than 7/16 full.
+  void rehash(void) {
+    signed char* old_ctrl = ctrl;
+    Slot* old_slots = slots;
+    uint old_cap = (mask + 1) * FlatMap_Group;
+    uint n_groups = 1;
+    while (n_groups * FlatMap_Group * 7 / 16 <= (uint)nelems) n_groups *= 2;
+
+    init(n_groups);
+    for (uint i = 0; i < old_cap; i++)
+      if (old_ctrl[i] >= 0) insert(old_slots[i].key, old_slots[i].datum);
+    delete[] old_ctrl;
+    delete[] old_slots;
+  }
+
+  //---------------------------------------------------------------------------------------------
+
+ public:
+  // Types:
+  typedef K Key;
+  typedef D Datum;
+
+  // Constructors:
+  FlatMap(void) : n_lookups(0), n_probes(0), max_probe(0), max_elems(0) { init(1); }
+  ~FlatMap(void) { dispose(); }
+
+  // Don't allow copying (not defined):
+  FlatMap& operator=(const FlatMap& other);
+  FlatMap(const FlatMap& other);
+
+  // Size operations:
+  int size(void) const { return nelems; }
+  int capacity(void) const { return (mask + 1) * FlatMap_Group; }
+  void clear(void) {
+    dispose();
+    init(1);
+  }
+
+  // Primitives:
+  bool peek(const K& key, D& result) const {
+    int i = find(key);
+    if (i == -1) return false;
+    result = slots[i].datum;
+    return true;
+  }
+
+  bool has(const K& key) const { return find(key) != -1; }
+
+  void set(const K& key, const D& value) {
+    int i = find(key);
+    if (i != -1) {
+      slots[i].datum = value;
+      return;
+    }
+    if (nused >= max_used) rehash();
+    insert(key, value);
+    if (nelems > max_elems) max_elems = nelems;
+  }
+
+  bool remove(const K& key) {
+    int i = find(key);
+    if (i == -1) return false;
+    // A group that still has an empty slot has never been full, so no probe sequence
+    // continues past it and the slot can go straight back to empty:
+    int g = i & ~(FlatMap_Group - 1);
+    if (match(&ctrl[g], FlatMap_Empty) != 0)
+      ctrl[i] = FlatMap_Empty, nused--;
+    else
+      ctrl[i] = FlatMap_Deleted;
+    nelems--;
+    return true;
+  }
+
+  // Removes every entry for which 'keep(key, datum)' is false, then rebuilds the table:
+  template <class Pred>
+  void filter(Pred keep) {
+    uint cap = (mask + 1) * FlatMap_Group;
+    for (uint i = 0; i < cap; i++)
+      if (ctrl[i] >= 0 && !keep(slots[i].key, slots[i].datum))
+        ctrl[i] = FlatMap_Deleted, nelems--;
+    rehash();
+  }
+
+  // Statistics:
+  double loadFactor(void) const { return (double)nelems / capacity(); }
+  double avgProbe(void) const { return n_lookups == 0 ? 0 : (double)n_probes / n_lookups; }
+  int maxProbe(void) const { return max_probe; }
+  int maxSize(void) const { return max_elems; }
+  uint64 lookups(void) const { return n_lookups; }
+};
+
+//=================================================================================================
+#endif
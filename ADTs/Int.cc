@@ -0,0 +1,284 @@
+/******************************************************************************************[Int.cc]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "Int.h"
+#include <gmp.h>
+#include <ostream>
+
+// The slow paths of 'Int' (bignums, sentinels and overflowing small values). Operands are
+// converted to GMP integers, and results are brought back to the small form when they fit.
+
+#define Int_SmallBits 62    // (small values are in '[-2^62, 2^62)')
+
+
+//=================================================================================================
+// Conversion to and from GMP:
+
+
+static inline mpz_ptr bigOf(int64 data) { return (mpz_ptr)(intp)(data - 1); }
+
+static void setInt64(mpz_ptr z, int64 x)
+{
+    uint64 u = x < 0 ? -(uint64)x : (uint64)x;
+    mpz_set_ui(z, (ulong)(u >> 32));
+    mpz_mul_2exp(z, z, 32);
+    mpz_add_ui(z, z, (ulong)(u & 0xFFFFFFFF));
+    if (x < 0) mpz_neg(z, z);
+}
+
+void toMpz_(const Int& a, void* z)
+{
+    assert(a.small() || a.big());
+    if (a.small()) setInt64((mpz_ptr)z, a.data >> 1);
+    else           mpz_set((mpz_ptr)z, bigOf(a.data));
+}
+
+static int64 newBig(mpz_srcptr z)
+{
+    mpz_ptr b = (mpz_ptr)malloc(sizeof(__mpz_struct));
+    if (b == NULL) fprintf(stderr, "ERROR! Out of memory for bignums.\n"), exit(1);
+    mpz_init_set(b, z);
+    return (int64)(intp)b + 1;
+}
+
+// Is 'z' in '[-2^62, 2^62)', the range of the small form? (same test as 'Int::set_(int64)')
+static bool fitsSmall(mpz_srcptr z)
+{
+    size_t bits = mpz_sizeinbase(z, 2);
+    if (bits <= Int_SmallBits) return true;
+    // '-2^62' needs one more bit of magnitude; it is the only negative value whose lowest set bit
+    // (in two's complement) is bit 62:
+    return bits == Int_SmallBits + 1 && mpz_sgn(z) < 0 && mpz_scan1(z, 0) == Int_SmallBits;
+}
+
+Int fromMpz_(const void* z_)
+{
+    mpz_srcptr z = (mpz_srcptr)z_;
+    if (fitsSmall(z)){
+        uint64 u = 0;
+        for (size_t i = 0; i < mpz_size(z); i++)
+            u |= (uint64)mpz_getlimbn(z, i) << (i * GMP_NUMB_BITS);
+        int64 x = mpz_sgn(z) < 0 ? -(int64)u : (int64)u;
+        return Int(x * 2, Int::Raw());
+    }else
+        return Int(newBig(z), Int::Raw());
+}
+
+// RAII wrapper of a temporary GMP integer:
+struct Mpz {
+    mpz_t z;
+    Mpz()                { mpz_init(z); }
+    Mpz(const Int& a)    { mpz_init(z); toMpz_(a, z); }
+   ~Mpz()                { mpz_clear(z); }
+    operator mpz_ptr()   { return z; }
+    Int  toInt() const   { return fromMpz_(z); }
+};
+
+
+//=================================================================================================
+// Representation:
+
+
+void Int::free_()
+{
+    mpz_clear(bigOf(data));
+    free(bigOf(data));
+}
+
+void Int::copy_(const Int& other)
+{
+    data = newBig(bigOf(other.data));
+}
+
+void Int::set_(int64 x)
+{
+    if (x >= -((int64)1 << Int_SmallBits) && x < ((int64)1 << Int_SmallBits))
+        data = x * 2;
+    else{
+        Mpz z;
+        setInt64(z, x);
+        data = 0;
+        *this = z.toInt();
+    }
+}
+
+void Int::set_(uint64 x)
+{
+    if (x < ((uint64)1 << Int_SmallBits))
+        data = (int64)x * 2;
+    else{
+        Mpz z;
+        mpz_set_ui(z, (ulong)(x >> 32));
+        mpz_mul_2exp(z, z, 32);
+        mpz_add_ui(z, z, (ulong)(x & 0xFFFFFFFF));
+        data = 0;
+        *this = z.toInt();
+    }
+}
+
+Int::Int(cchar* text) : data(0)
+{
+    Mpz z;
+    if (*text == '+') text++;
+    if (mpz_set_str(z, text, 10) == 0)
+        *this = z.toInt();
+}
+
+
+#ifndef NDEBUG
+// Both ends of the small range must get the same encoding from 'set_()' as from a GMP slow path
+// ('operator==' and 'hash()' compare encodings). Checked once at startup in debug builds:
+static struct CheckSmallRange {
+    CheckSmallRange() {
+        const int64 lim = (int64)1 << Int_SmallBits;
+        Int lo(-lim), hi(lim - 1), big(lim);
+        Int lo_gmp = -big, hi_gmp = big - 1, lo_text("-4611686018427387904");
+        assert(lo == lo_gmp && lo.hash() == lo_gmp.hash() && lo == lo_text);
+        assert(hi == hi_gmp && hi.hash() == hi_gmp.hash());
+        assert(lo - 1 != lo_gmp && -(lo - 1) - 1 == big);
+    }
+} check_small_range;
+#endif
+
+
+//=================================================================================================
+// Slow paths of the operators:
+
+
+static inline bool isFinite(const Int& a) { return a != Int_MAX && a != Int_MIN; }
+
+Int add_(const Int& a, const Int& b)
+{
+    if (!isFinite(a) || !isFinite(b)){
+        assert(isFinite(a) || isFinite(b) || a == b);     // ('+oo + -oo' is undefined)
+        return isFinite(a) ? b : a; }
+    Mpz x(a), y(b), r;
+    mpz_add(r, x, y);
+    return r.toInt();
+}
+
+Int sub_(const Int& a, const Int& b)
+{
+    if (!isFinite(b))
+        return add_(a, b == Int_MAX ? Int_MIN : Int_MAX);
+    if (!isFinite(a))
+        return a;
+    Mpz x(a), y(b), r;
+    mpz_sub(r, x, y);
+    return r.toInt();
+}
+
+Int mul_(const Int& a, const Int& b)
+{
+    if (!isFinite(a) || !isFinite(b)){
+        assert(a != 0 && b != 0);
+        bool neg = (a < 0 || a == Int_MIN) != (b < 0 || b == Int_MIN);
+        return neg ? Int_MIN : Int_MAX; }
+    Mpz x(a), y(b), r;
+    mpz_mul(r, x, y);
+    return r.toInt();
+}
+
+Int div_(const Int& a, const Int& b, bool rem)      // (rounds towards zero, as for 'int')
+{
+    assert(isFinite(a) && isFinite(b) && b != 0);
+    Mpz x(a), y(b), r;
+    if (rem) mpz_tdiv_r(r, x, y);
+    else     mpz_tdiv_q(r, x, y);
+    return r.toInt();
+}
+
+Int and_(const Int& a, const Int& b)
+{
+    assert(isFinite(a) && isFinite(b));
+    Mpz x(a), y(b), r;
+    mpz_and(r, x, y);
+    return r.toInt();
+}
+
+Int shr_(const Int& a, int n)
+{
+    if (!isFinite(a)) return a;
+    Mpz x(a), r;
+    mpz_fdiv_q_2exp(r, x, n);
+    return r.toInt();
+}
+
+int cmp_(const Int& a, const Int& b)
+{
+    int ra = (a.data == Int_MAX__) - (a.data == Int_MIN__);
+    int rb = (b.data == Int_MAX__) - (b.data == Int_MIN__);
+    if (ra != 0 || rb != 0)
+        return ra - rb;
+    Mpz x(a), y(b);
+    return mpz_cmp(x, y);
+}
+
+
+//=================================================================================================
+// Other methods:
+
+
+Int::operator int64() const
+{
+    if (small())            return data >> 1;
+    else if (!big())        return data == Int_MAX__ ? LLONG_MAX : LLONG_MIN;
+    mpz_srcptr z = bigOf(data);
+    uint64 u = 0;
+    for (size_t i = 0; i < mpz_size(z) && i * GMP_NUMB_BITS < 64; i++)
+        u |= (uint64)mpz_getlimbn(z, i) << (i * GMP_NUMB_BITS);
+    return mpz_sgn(z) < 0 ? -(int64)u : (int64)u;
+}
+
+uint Int::hash() const
+{
+    if (!big()) return (uint)(data ^ (data >> 32));
+    mpz_srcptr z = bigOf(data);
+    uint h = mpz_sgn(z);
+    for (size_t i = 0; i < mpz_size(z); i++){
+        uint64 limb = mpz_getlimbn(z, i);
+        h = h * 31 + (uint)(limb ^ (limb >> 32)); }
+    return h;
+}
+
+char* Int::toString() const
+{
+    char* ret;
+    if (small()){
+        ret = new char[24];
+        sprintf(ret, "%" I64_fmt, (int64)(data >> 1));
+    }else if (!big()){
+        ret = new char[4];
+        strcpy(ret, data == Int_MAX__ ? "+oo" : "-oo");
+    }else{
+        ret = new char[mpz_sizeinbase(bigOf(data), 10) + 2];
+        mpz_get_str(ret, 10, bigOf(data));
+    }
+    return ret;
+}
+
+char* toString(Int& x) { return x.toString(); }
+
+std::ostream& operator<<(std::ostream& out, const Int& x)
+{
+    char* tmp = x.toString();
+    out << tmp;
+    delete [] tmp;
+    return out;
+}
@@ -30,7 +30,7 @@ SOFTWARE.
 #ifndef Int_h
 #define Int_h
 
-typedef  int Int;
+#include <iosfwd>
 
 //=================================================================================================
 
@@ -40,24 +40,162 @@ struct Exception_IntOverflow {
 };
 
 //=================================================================================================
-// Fake bignums using 'int64':
-//=================================================================================================
+// Int -- bignums with an inline 64-bit representation:
+//
+// The single word 'data' is one of:
+//
+//   - even:          a small value 'v' in '[-2^62, 2^62)', stored as '2*v'
+//   - 'Int_MAX__':   +oo (absorbs finite values in additions)
+//   - 'Int_MIN__':   -oo
+//   - otherwise:     1 + pointer to a GMP integer outside that range (owned, copied on copy)
+//
+// Values are always stored in the small form if they fit, so a bignum is never equal
+// to a small value. The operators below handle two small values inline (a scaled sum or
+// product that overflows falls back on 'Int.cc', which uses GMP).
+
+#define Int_MAX__ 3
+#define Int_MIN__ 5
+
+class Int {
+  int64 data;
+
+  struct Raw {};
+  Int(int64 d, Raw) : data(d) {}
+  bool small() const { return (data & 1) == 0; }
+  bool big() const { return (data & 7) == 1; }  // ('malloc()' memory is 8-aligned)
+  void free_();
+  void copy_(const Int& other);
+  void set_(int64 x);
+  void set_(uint64 x);
+
+  friend Int add_(const Int& a, const Int& b);
+  friend Int sub_(const Int& a, const Int& b);
+  friend Int mul_(const Int& a, const Int& b);
+  friend Int div_(const Int& a, const Int& b, bool rem);
+  friend Int and_(const Int& a, const Int& b);
+  friend Int shr_(const Int& a, int n);
+  friend int cmp_(const Int& a, const Int& b);
+  friend Int fromMpz_(const void* z);
+  friend void toMpz_(const Int& a, void* z);
+
+  friend Int operator+(const Int& a, const Int& b);
+  friend Int operator-(const Int& a, const Int& b);
+  friend Int operator*(const Int& a, const Int& b);
+  friend Int operator/(const Int& a, const Int& b);
+  friend Int operator%(const Int& a, const Int& b);
+  friend Int operator&(const Int& a, const Int& b);
+  friend Int operator>>(const Int& a, int n);
+  friend bool operator==(const Int& a, const Int& b);
+  friend bool operator<(const Int& a, const Int& b);
+
+ public:
+  Int() : data(0) {}
+  Int(int x) : data((int64)x * 2) {}
+  Int(uint x) : data((int64)x * 2) {}
+  Int(long x) { set_((int64)x); }
+  Int(ulong x) { set_((uint64)x); }
+  Int(long long x) { set_((int64)x); }
+  Int(unsigned long long x) { set_((uint64)x); }
+  explicit Int(cchar* text);  // (decimal, with an optional sign; 0 if invalid)
+  static Int sentinel(int tag) { return Int(tag, Raw()); }  // (see 'Int_MAX'/'Int_MIN')
+
+  Int(const Int& other) : data(other.data) {
+    if (big()) copy_(other);
+  }
+  Int(Int&& other) : data(other.data) { other.data = 0; }
+  ~Int() {
+    if (big()) free_();
+  }
+  Int& operator=(const Int& other) {
+    if (this != &other) {
+      if (big()) free_();
+      data = other.data;
+      if (big()) copy_(other);
+    }
+    return *this;
+  }
+  Int& operator=(Int&& other) {
+    int64 d = data;
+    data = other.data, other.data = d;  // ('other' frees the old value)
+    return *this;
+  }
+
+  explicit operator int64() const;  // (finite values only; bignums are truncated)
+  explicit operator int() const { return (int)(int64)(*this); }
+
+  Int operator-() const;
+  Int& operator+=(const Int& other) { return *this = *this + other; }
+  Int& operator-=(const Int& other) { return *this = *this - other; }
+  Int& operator*=(const Int& other) { return *this = *this * other; }
+  Int& operator/=(const Int& other) { return *this = *this / other; }
+  Int& operator%=(const Int& other) { return *this = *this % other; }
+  Int& operator>>=(int n) { return *this = *this >> n; }
+
+  uint hash() const;
+  char* toString() const;  // (free with 'delete[]')
+};
 
+#define Int_MAX Int::sentinel(Int_MAX__)
+#define Int_MIN Int::sentinel(Int_MIN__)
 
 //-------------------------------------------------------------------------------------------------
 
-#define A1 assert(data != Int_Undef__);
-#define A2 assert(data != Int_Undef__), assert(other.data != Int_Undef__);
-
-
-
-#define Int_MAX  1000000
-#define Int_MIN  -100000
-
-
-
- char*toString(Int &x);
-
-
+inline Int operator+(const Int& a, const Int& b) {
+  int64 r;
+  if (((a.data | b.data) & 1) == 0 && !__builtin_add_overflow(a.data, b.data, &r))
+    return Int(r, Int::Raw());
+  return add_(a, b);
+}
+inline Int operator-(const Int& a, const Int& b) {
+  int64 r;
+  if (((a.data | b.data) & 1) == 0 && !__builtin_sub_overflow(a.data, b.data, &r))
+    return Int(r, Int::Raw());
+  return sub_(a, b);
+}
+inline Int operator*(const Int& a, const Int& b) {
+  int64 r;
+  if (((a.data | b.data) & 1) == 0 && !__builtin_mul_overflow(a.data >> 1, b.data, &r))
+    return Int(r, Int::Raw());
+  return mul_(a, b);
+}
+inline Int operator/(const Int& a, const Int& b) {
+  if (((a.data | b.data) & 1) == 0 && b.data != 0 && b.data != -2)
+    return Int((a.data >> 1) / (b.data >> 1) * 2, Int::Raw());
+  return div_(a, b, false);
+}
+inline Int operator%(const Int& a, const Int& b) {
+  if (((a.data | b.data) & 1) == 0 && b.data != 0)
+    return Int(a.data % b.data, Int::Raw());  // ('2a % 2b == 2(a % b)')
+  return div_(a, b, true);
+}
+inline Int operator&(const Int& a, const Int& b) {
+  if (((a.data | b.data) & 1) == 0) return Int(a.data & b.data, Int::Raw());
+  return and_(a, b);
+}
+inline Int operator>>(const Int& a, int n) {  // (rounds towards -oo)
+  if (a.small() && n < 63) return Int((a.data >> n) & ~(int64)1, Int::Raw());
+  return shr_(a, n);
+}
+inline Int Int::operator-() const {
+  int64 r;
+  if (small() && !__builtin_sub_overflow((int64)0, data, &r)) return Int(r, Raw());
+  return sub_(Int(), *this);
+}
+
+inline bool operator==(const Int& a, const Int& b) {
+  return a.data == b.data || (a.big() && b.big() && cmp_(a, b) == 0);
+}
+inline bool operator<(const Int& a, const Int& b) {
+  if (((a.data | b.data) & 1) == 0) return a.data < b.data;
+  return cmp_(a, b) < 0;
+}
+inline bool operator!=(const Int& a, const Int& b) { return !(a == b); }
+inline bool operator>(const Int& a, const Int& b) { return b < a; }
+inline bool operator<=(const Int& a, const Int& b) { return !(b < a); }
+inline bool operator>=(const Int& a, const Int& b) { return !(a < b); }
+
+std::ostream& operator<<(std::ostream& out, const Int& x);
+
+char* toString(Int& x);  // (free with 'delete[]')
 
 #endif
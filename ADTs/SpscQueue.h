@@ -0,0 +1,126 @@
+/*************************************************************************************[SpscQueue.h]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and
+associated documentation files (the "Software"), to deal in the Software without
+restriction,
+including without limitation the rights to use, copy, modify, merge, publish,
+distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom
+the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************************************/
+
+#ifndef SpscQueue_h
+#define SpscQueue_h
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+//=================================================================================================
+// SpscQueue -- a bounded, lock-free queue for exactly one producer thread and one consumer thread.
+//
+// 'tryPush()'/'push()' may only be called by the producer and 'tryPop()'/'pop()' only by the
+// consumer. The 'try' versions return FALSE instead of blocking (queue full or empty,
+// respectively); the others spin for a short while and then sleep until the other side makes
+// progress. 'cancel()' makes waiting and later calls to 'push()' return FALSE.
+
+#define SpscQueue_Spins 256
+
+template <class T>
+class SpscQueue {
+  vector<T> data;
+  uint mask;  // 'data.size() - 1' (size is a power of two).
+  alignas(64) std::atomic<uint> head;  // Next element to pop (written by consumer).
+  alignas(64) std::atomic<uint> tail;  // Next element to push (written by producer).
+
+  std::atomic<bool> cancelled;
+  std::atomic<int> sleepers;  // Threads in 'sleep()'.
+  std::mutex lock;
+  std::condition_variable changed;
+
+  // Waits until 'ready()' holds (checked after announcing the wait, so that a 'wake()' from the
+  // other side can't be missed):
+  template <class Pred>
+  void sleep(Pred ready) {
+    for (int i = 0; i < SpscQueue_Spins; i++)
+      if (ready()) return;
+    std::unique_lock<std::mutex> guard(lock);
+    sleepers++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    changed.wait(guard, ready);
+    sleepers--;
+  }
+
+  void wake(void) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load() > 0) {
+      std::lock_guard<std::mutex> guard(lock);
+      changed.notify_all();
+    }
+  }
+
+ public:
+  SpscQueue(int capacity) : head(0), tail(0), cancelled(false), sleepers(0) {
+    uint size = 1;
+    while (size < (uint)capacity) size *= 2;
+    data.resize(size);
+    mask = size - 1;
+  }
+
+  bool tryPush(const T& elem) {
+    uint t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) > mask) return false;
+    data[t & mask] = elem;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& elem) {
+    uint h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    elem = data[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool push(const T& elem) {
+    bool ok = false;
+    sleep([&]() { return cancelled || (ok = tryPush(elem)); });
+    if (!ok) return false;
+    wake();
+    return true;
+  }
+
+  void pop(T& elem) {
+    sleep([&]() { return tryPop(elem); });
+    wake();
+  }
+
+  void cancel(void) {
+    cancelled = true;
+    std::lock_guard<std::mutex> guard(lock);
+    changed.notify_all();
+  }
+  bool isCancelled(void) const { return cancelled; }
+};
+
+//=================================================================================================
+#endif
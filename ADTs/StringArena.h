@@ -0,0 +1,74 @@
+/*************************************************************************************[StringArena.h]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and
+associated documentation files (the "Software"), to deal in the Software without
+restriction,
+including without limitation the rights to use, copy, modify, merge, publish,
+distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom
+the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************************************/
+
+#ifndef StringArena_h
+#define StringArena_h
+
+//=================================================================================================
+// StringArena -- stores many small, immutable strings in a few large blocks.
+//
+// Strings are never freed individually; everything is released when the arena is destroyed.
+// Blocks are never moved, so returned pointers stay valid for the lifetime of the arena.
+
+#define StringArena_BlockSize (1 << 20)
+
+class StringArena {
+  vector<char*> blocks;
+  char* free_ptr;  // Next free byte in the last block.
+  int free_left;   // Bytes left in the last block.
+
+ public:
+  StringArena(void) : free_ptr(NULL), free_left(0) {}
+  ~StringArena(void) {
+    for (size_t i = 0; i < blocks.size(); i++) delete[] blocks[i];
+  }
+
+  // Don't allow copying (not defined):
+  StringArena& operator=(const StringArena& other);
+  StringArena(const StringArena& other);
+
+  // Returns a copy of 'str' (zero-terminated) stored in the arena.
+  cchar* add(cchar* str) {
+    int size = strlen(str) + 1;
+    if (size > free_left) {
+      int block_size = max(size, StringArena_BlockSize);
+      blocks.push_back(new char[block_size]);
+      free_ptr = blocks.back();
+      free_left = block_size;
+    }
+    char* ret = free_ptr;
+    memcpy(ret, str, size);
+    free_ptr += size;
+    free_left -= size;
+    return ret;
+  }
+};
+
+//=================================================================================================
+#endif
@@ -34,19 +34,46 @@ SOFTWARE.
 #include "PbSolver.h"
 #include "FEnv.h"
 
+//=================================================================================================
+// Coefficient types of the encoders:
+//
+// The encoders are templates over the type 'T' of their coefficients, chosen per constraint by
+// 'coefWidth()': 'int' or 'int64' (no overflow checks) if every sum they form fits, else 'Int'.
+// 'Coef<T>' maps the sentinels 'Int_MIN'/'Int_MAX' to the extremes of 'T'.
+
+enum CoefWidth { cw_Int, cw_Int64, cw_Big };
+CoefWidth coefWidth(const Linear& c);
+
+template <class T>
+struct Coef {
+  static T min() { return std::numeric_limits<T>::min(); }
+  static T max() { return std::numeric_limits<T>::max(); }
+  static T from(const Int& x) {
+    return x == Int_MIN ? min() : x == Int_MAX ? max() : (T)(int64)x;
+  }
+};
+template <>
+struct Coef<Int> {
+  static Int min() { return Int_MIN; }
+  static Int max() { return Int_MAX; }
+  static Int from(const Int& x) { return x; }
+};
+
 //=================================================================================================
 
 void clearClausify(void);
+void compactClausify(void);
 
 int estimatedAdderCost(const Linear& c);
 void oddEvenSort(vector<Formula>& fs);
 void rippleAdder(const vector<Formula>& xs, const vector<Formula>& ys,
                  vector<Formula>& out);
-void addPb(const vector<Formula>& ps, const vector<Int>& Cs_, vector<Formula>& out,
-           int bits);
+template <class T>
+void addPb(const vector<Formula>& ps, const vector<T>& Cs_, vector<Formula>& out, int bits);
 
 void clausify(SimpSolver& s, const vector<Formula>& fs, vector<Lit>& out);
 void clausify(SimpSolver& s, const vector<Formula>& fs);
+bool sweep(vector<Formula>& fs, double& time_left);
 
 //=================================================================================================
 #endif
@@ -21,13 +21,14 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "Debug.h"
 
 
-int estimatedAdderCost(const Linear& c)
+template<class T>
+static int estimatedAdderCost(const Linear& c)
 {
   // (sorry about strange implementation -- copy/paste programming)
-  vector<Int>    Cs(c.size);
-  Int         max_C = -1;
+  vector<T>      Cs(c.size);
+  T           max_C = -1;
   for (int i = 0; i < c.size; i++){
-    Cs[i] = c(i);
+    Cs[i] = Coef<T>::from(c(i));
     if (Cs[i] > max_C)
       max_C = Cs[i];
   }
@@ -44,6 +45,15 @@ int estimatedAdderCost(const Linear& c)
   return cost;
 }
 
+int estimatedAdderCost(const Linear& c)
+{
+  switch (coefWidth(c)){
+  case cw_Int:   return estimatedAdderCost<int>  (c);
+  case cw_Int64: return estimatedAdderCost<int64>(c);
+  default:       return estimatedAdderCost<Int>  (c);
+  }
+}
+
 
 void rippleAdder(const vector<Formula>& xs, const vector<Formula>& ys, vector<Formula>& out)
 {
@@ -65,7 +75,7 @@ void rippleAdder(const vector<Formula>& xs, const vector<Formula>& ys, vector<Fo
 
 /*_________________________________________________________________________________________________
   |
-  |  addPb : (ps : const vec<Formula>&) (Cs_ : const vec<Int>&) (out : vec<Formula>&) (bits : int)
+  |  addPb : (ps : const vec<Formula>&) (Cs_ : const vec<T>&) (out : vec<Formula>&) (bits : int)
   |            ->  [void]
   |  
   |  Description:
@@ -74,12 +84,13 @@ void rippleAdder(const vector<Formula>& xs, const vector<Formula>& ys, vector<Fo
   |    "overflow" bit, so "out.size() <= bits + 1".
   |________________________________________________________________________________________________@*/
 
-void addPb(const vector<Formula>& ps, const vector<Int>& Cs_, vector<Formula>& out, int bits)
+template<class T>
+void addPb(const vector<Formula>& ps, const vector<T>& Cs_, vector<Formula>& out, int bits)
 {
   assert(ps.size() == Cs_.size());
   vector<vector<Formula> >  pools;
-  vector<Int>            Cs(Cs_.size());
-  Int                 max_C = -1;
+  vector<T>              Cs(Cs_.size());
+  T                   max_C = -1;
   for (int i = 0; i < Cs_.size(); i++){
     Cs[i] = Cs_[i];
     if (Cs[i] > max_C)
@@ -147,3 +158,7 @@ void addPb(const vector<Formula>& ps, const vector<Int>& Cs_, vector<Formula>& o
   }
 #endif
 }
+
+template void addPb(const vector<Formula>& ps, const vector<int>&   Cs_, vector<Formula>& out, int bits);
+template void addPb(const vector<Formula>& ps, const vector<int64>& Cs_, vector<Formula>& out, int bits);
+template void addPb(const vector<Formula>& ps, const vector<Int>&   Cs_, vector<Formula>& out, int bits);
@@ -80,9 +80,36 @@ CMap<int> Clausifier::occ(0);
 CMap<Var> Clausifier::vmap(var_Undef);
 CMap<Lit, true> Clausifier::vmapp(lit_Undef);
 
+static int compacted_size = 0;  // DAG size after the last 'compactClausify()'.
+
 void clearClausify(void) {
   FEnv::init();
   Clausifier::clear();
+  compacted_size = 0;
+}
+
+static bool clausified(Formula f) {
+  return Clausifier::vmap.at(f) != var_Undef ||
+         Clausifier::vmapp.at(f) != lit_Undef ||
+         Clausifier::vmapp.at(~f) != lit_Undef;
+}
+
+// Only nodes below a clausified node can be met again (through structural hashing); everything
+// else left over from earlier conversions is dropped. Runs when the DAG has doubled since the
+// last compaction, so the cost is amortized over the nodes created.
+void compactClausify(void) {
+  if (FEnv::size() < 2 * compacted_size + 1024) return;
+
+  vector<int> new_index[3];
+  int before = FEnv::size();
+  FEnv::compact(clausified, new_index);
+  Clausifier::occ.renumber(new_index);
+  Clausifier::vmap.renumber(new_index);
+  Clausifier::vmapp.renumber(new_index);
+  compacted_size = FEnv::size();
+
+  if (opt_verbosity >= 2)
+    reportf("  -- Formula compaction: %d of %d nodes kept\n", compacted_size, before);
 }
 void Clausifier::usage(const Formula& f) {
   if (Atom_p(f)) return;
@@ -105,5 +105,5 @@ void oddEvenSort(vector<Formula>& fs)
     for (int i = 1; i < fs.size(); i *= 2)
         for (int j = 0; j + 2*i <= fs.size(); j += 2*i)
             oddEvenMerge(fs,j,j+2*i);
-    fs.resize(sz - orig_sz);
+    fs.resize(orig_sz);     // (drops the padding, which sorts last)
 }
@@ -0,0 +1,354 @@
+/******************************************************************************[Hardware_sweep.cc]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and
+associated documentation files (the "Software"), to deal in the Software without
+restriction,
+including without limitation the rights to use, copy, modify, merge, publish,
+distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom
+the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************************************/
+
+#include "Hardware.h"
+#include "minisat/core/Solver.h"
+#include "minisat/utils/System.h"
+
+//=================================================================================================
+// Sweeping -- merges functionally equivalent nodes that structural hashing missed.
+//
+// Every node of the cone is simulated on 'Sweep_Words * 64' pseudo-random input patterns, 64 at a
+// time per machine word. Nodes whose signatures agree (up to complement) with an earlier node or an
+// atom are candidates; a candidate is merged only if a SAT check with a small conflict budget
+// proves the equivalence. A refuted check yields an input pattern that tells the two apart; every
+// 64 such patterns make up one more simulation word (up to 'Sweep_MaxWords'), after which the
+// classes are rebuilt. Signatures that are almost constant are skipped; sorter networks are full of
+// rarely true nodes that random patterns can't tell apart. No more checks are started once the
+// time budget of the caller is used up.
+
+#define Sweep_Words 4           // Random words (256 patterns).
+#define Sweep_MaxWords 8        // Random words plus words of counterexamples.
+#define Sweep_ConfBudget 1000   // Conflicts per SAT check.
+
+struct Signature {
+  uint64 w[Sweep_MaxWords];
+
+  unsigned hash(void) const {
+    uint64 h = 0;
+    for (int k = 0; k < Sweep_MaxWords; k++) h = (h ^ w[k]) * 0x9E3779B97F4A7C15ULL;
+    return (unsigned)(h >> 32);
+  }
+  bool operator==(const Signature& other) const {
+    for (int k = 0; k < Sweep_MaxWords; k++)
+      if (w[k] != other.w[k]) return false;
+    return true;
+  }
+};
+
+// Random input patterns of an atom (fixed per index, so that runs are reproducible):
+static uint64 atomWord(int index, int k) {
+  uint64 x = (uint64)index * Sweep_MaxWords + k + 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+struct Sweeper {
+  vector<Formula> order;  // Composite nodes of the cone, children before parents.
+  vector<Formula> atoms;  // Atoms of the cone (no constants).
+  CMap<int> pos;          // Node -> position in 'order' (-1 if not in the cone).
+  AMap<int> atom_pos;     // Atom -> position in 'atoms' plus one (0 if not in the cone).
+  vector<uint64> sim;     // 'Sweep_MaxWords' words per position in 'order'...
+  vector<uint64> atom_sim;  // ...and in 'atoms'.
+  int n_words;            // Words simulated so far.
+  int n_pending;          // Counterexamples collected for word 'n_words'.
+
+  Minisat::Solver s;      // For proving candidate equivalences.
+  Minisat::vec<Lit> assumps;
+  vector<Lit> atom_lit;
+  CMap<Lit> node_lit;
+  Lit lit_true;
+
+  Sweeper(void) : pos(-1), n_words(Sweep_Words), n_pending(0), node_lit(lit_Undef) {
+    lit_true = mkLit(s.newVar());
+    s.addClause(lit_true);
+  }
+
+  void collect(Formula f);
+  void value(Formula f, uint64* out, int k0, int k1);
+  void simulate(int p, int k0, int k1);
+  bool signature(Formula f, Signature& sig, bool& phase);
+  Lit lit(Formula f);
+  lbool equivalent(Formula f, Formula g);
+  bool addCounterexample(void);
+};
+
+void Sweeper::collect(Formula f) {
+  f = unsign(f);
+  if (Atom_p(f)) {
+    if (!Const_p(f) && atom_pos.at(f) == 0) {
+      atom_pos.set(f, atoms.size() + 1);
+      atoms.push_back(f);
+      for (int k = 0; k < Sweep_MaxWords; k++)
+        atom_sim.push_back(k < Sweep_Words ? atomWord(index(f), k) : 0);
+    }
+    return;
+  }
+  if (pos.at(f) != -1) return;
+  pos.set(f, -2);  // (visiting)
+
+  if (Bin_p(f))
+    collect(left(f)), collect(right(f));
+  else if (ITE_p(f))
+    collect(cond(f)), collect(tt(f)), collect(ff(f));
+  else
+    collect(FA_x(f)), collect(FA_y(f)), collect(FA_c(f));
+
+  pos.set(f, order.size());
+  order.push_back(f);
+}
+
+// Simulated words 'k0..k1-1' of 'f' (which must be simulated already if composite):
+void Sweeper::value(Formula f, uint64* out, int k0, int k1) {
+  uint64 inv = sign(f) ? ~(uint64)0 : 0;
+  const uint64* src = Const_p(f) ? NULL
+                      : Atom_p(f) ? &atom_sim[(atom_pos.at(f) - 1) * Sweep_MaxWords]
+                                  : &sim[pos.at(unsign(f)) * Sweep_MaxWords];
+  for (int k = k0; k < k1; k++) out[k] = (src == NULL ? ~(uint64)0 : src[k]) ^ inv;
+}
+
+void Sweeper::simulate(int p, int k0, int k1) {
+  Formula f = order[p];
+  uint64 a[Sweep_MaxWords], b[Sweep_MaxWords], c[Sweep_MaxWords];
+  uint64* out = &sim[p * Sweep_MaxWords];
+
+  if (Bin_p(f)) {
+    value(left(f), a, k0, k1), value(right(f), b, k0, k1);
+    for (int k = k0; k < k1; k++)
+      out[k] = (op(f) == op_And) ? a[k] & b[k] : ~(a[k] ^ b[k]);
+  } else if (ITE_p(f)) {
+    value(cond(f), a, k0, k1), value(tt(f), b, k0, k1), value(ff(f), c, k0, k1);
+    for (int k = k0; k < k1; k++) out[k] = (a[k] & b[k]) | (~a[k] & c[k]);
+  } else {
+    value(FA_x(f), a, k0, k1), value(FA_y(f), b, k0, k1), value(FA_c(f), c, k0, k1);
+    for (int k = k0; k < k1; k++)
+      out[k] = isCarry(f) ? (a[k] & b[k]) | (a[k] & c[k]) | (b[k] & c[k])
+                          : a[k] ^ b[k] ^ c[k];
+  }
+}
+
+// Signature of 'f', normalized so that the first pattern evaluates to FALSE ('phase' tells if
+// that complemented it). Returns FALSE if it is too close to constant to be of use.
+bool Sweeper::signature(Formula f, Signature& sig, bool& phase) {
+  value(f, sig.w, 0, n_words);
+  phase = sig.w[0] & 1;
+  int ones = 0;
+  for (int k = 0; k < Sweep_MaxWords; k++) {
+    sig.w[k] = (k < n_words) ? sig.w[k] ^ (phase ? ~(uint64)0 : 0) : 0;
+    ones += __builtin_popcountll(sig.w[k]);
+  }
+  return ones >= n_words * 4;
+}
+
+// Literal for 'f' in the checking solver (Tseitin-encoding its cone on demand):
+Lit Sweeper::lit(Formula f) {
+  if (Const_p(f)) return sign(f) ? ~lit_true : lit_true;
+  if (Atom_p(f)) {
+    if (index(f) >= (int)atom_lit.size()) atom_lit.resize(index(f) + 1, lit_Undef);
+    if (atom_lit[index(f)] == lit_Undef) atom_lit[index(f)] = mkLit(s.newVar());
+    return atom_lit[index(f)] ^ sign(f);
+  }
+  Formula g = unsign(f);
+  if (node_lit.at(g) != lit_Undef) return node_lit.at(g) ^ sign(f);
+
+  Lit p = mkLit(s.newVar());
+  if (Bin_p(g)) {
+    Lit l = lit(left(g)), r = lit(right(g));
+    if (op(g) == op_And) {
+      s.addClause(~p, l), s.addClause(~p, r), s.addClause(p, ~l, ~r);
+    } else {
+      s.addClause(~p, ~l, r), s.addClause(~p, l, ~r);
+      s.addClause(p, ~l, ~r), s.addClause(p, l, r);
+    }
+  } else if (ITE_p(g)) {
+    Lit c = lit(cond(g)), a = lit(tt(g)), b = lit(ff(g));
+    s.addClause(~p, ~c, a), s.addClause(~p, c, b);
+    s.addClause(p, ~c, ~a), s.addClause(p, c, ~b);
+  } else {
+    Lit a = lit(FA_x(g)), b = lit(FA_y(g)), c = lit(FA_c(g));
+    if (isCarry(g)) {
+      s.addClause(~p, a, b), s.addClause(~p, c, a), s.addClause(~p, c, b);
+      s.addClause(p, ~c, ~a), s.addClause(p, ~c, ~b), s.addClause(p, ~a, ~b);
+    } else {
+      Minisat::vec<Lit> cl;
+      for (int m = 0; m < 16; m++) {  // (all rows of p = a ^ b ^ c with an odd number of negations)
+        bool np = m & 1, na = m & 2, nb = m & 4, nc = m & 8;
+        if ((np + na + nb + nc) % 2 == 0) continue;
+        cl.clear();
+        cl.push(p ^ np), cl.push(a ^ na), cl.push(b ^ nb), cl.push(c ^ nc);
+        s.addClause(cl);
+      }
+    }
+  }
+  node_lit.set(g, p);
+  return p ^ sign(f);
+}
+
+// Is 'f == g'? Returns 'l_Undef' if the conflict budget ran out. Proved equivalences are added to
+// the checking solver to help later checks.
+lbool Sweeper::equivalent(Formula f, Formula g) {
+  Lit a = lit(f), b = lit(g);
+  for (int i = 0; i < 2; i++) {
+    assumps.clear();
+    assumps.push(i == 0 ? a : ~a);
+    assumps.push(i == 0 ? ~b : b);
+    s.setConfBudget(Sweep_ConfBudget);
+    lbool res = s.solveLimited(assumps);
+    if (res != l_False) return res == l_True ? l_False : l_Undef;
+  }
+  s.addClause(~a, b), s.addClause(a, ~b);
+  return l_True;
+}
+
+// Records the input pattern of the last (satisfiable) check. Returns TRUE if that completed a new
+// simulation word; the caller must then simulate it and rebuild the classes.
+bool Sweeper::addCounterexample(void) {
+  if (n_words == Sweep_MaxWords) return false;
+  for (int i = 0; i < (int)atoms.size(); i++) {
+    int x = index(atoms[i]);
+    bool v = (x < (int)atom_lit.size() && atom_lit[x] != lit_Undef)
+                 ? s.model[var(atom_lit[x])] == l_True
+                 : (atomWord(x, n_words) >> n_pending) & 1;  // (not in the checked cones)
+    if (v) atom_sim[i * Sweep_MaxWords + n_words] |= (uint64)1 << n_pending;
+  }
+  if (++n_pending < 64) return false;
+  n_words++;
+  n_pending = 0;
+  return true;
+}
+
+//=================================================================================================
+
+// Merges equivalent nodes in the cone of 'fs' and rebuilds the formulas on top of the survivors.
+// Formulas that become '_1_' are removed. Returns FALSE if one of them became '_0_'. The CPU time
+// spent is subtracted from 'time_left'.
+bool sweep(vector<Formula>& fs, double& time_left) {
+  if (time_left <= 0) return true;
+  double start = Minisat::cpuTime();
+  double deadline = start + time_left;
+  Sweeper sw;
+  for (int i = 0; i < (int)fs.size(); i++) sw.collect(fs[i]);
+  if (sw.order.size() == 0) return true;
+  sw.sim.resize(sw.order.size() * Sweep_MaxWords);
+
+  // Classes by signature; each maps to its (normalized) representative, an atom or an earlier
+  // node that was not merged:
+  FlatMap<Signature, FmlWord> reps;
+  vector<Formula> merged(sw.order.size(), _undef_);
+  Signature sig;
+  bool phase;
+  int n_merged = 0, n_refuted = 0, n_undecided = 0, n_checks = 0;
+  bool out_of_time = false;
+  for (int i = 0; i < (int)sw.atoms.size(); i++)
+    if (sw.signature(sw.atoms[i], sig, phase) && !reps.has(sig))
+      reps.set(sig, id(sw.atoms[i], phase));
+
+  for (int p = 0; p < (int)sw.order.size(); p++) {
+    sw.simulate(p, 0, sw.n_words);
+    FmlWord rep;
+    if (!sw.signature(sw.order[p], sig, phase)) continue;
+    if (!reps.peek(sig, rep)) {
+      reps.set(sig, id(sw.order[p], phase));
+      continue;
+    }
+    if (Minisat::cpuTime() > deadline) {
+      out_of_time = true;
+      break;
+    }
+
+    Formula cand = id(Formula(rep), phase);
+    n_checks++;
+    lbool res = sw.equivalent(sw.order[p], cand);
+    if (res == l_True)
+      merged[p] = cand, n_merged++;
+    else if (res == l_Undef)
+      n_undecided++;
+    else {
+      n_refuted++;
+      if (sw.addCounterexample()) {
+        reps.clear();
+        for (int i = 0; i < (int)sw.atoms.size(); i++)
+          if (sw.signature(sw.atoms[i], sig, phase) && !reps.has(sig))
+            reps.set(sig, id(sw.atoms[i], phase));
+        for (int q = 0; q <= p; q++) {
+          sw.simulate(q, sw.n_words - 1, sw.n_words);
+          if (merged[q] == _undef_ && sw.signature(sw.order[q], sig, phase) && !reps.has(sig))
+            reps.set(sig, id(sw.order[q], phase));
+        }
+      }
+    }
+  }
+
+  // Rebuild (children first) with the merged nodes replaced:
+  vector<Formula> repl(sw.order.size());
+#define Subst(g) (compo(g) ? id(repl[sw.pos.at(unsign(g))], sign(g)) : (g))
+  for (int p = 0; p < (int)sw.order.size(); p++) {
+    Formula f = sw.order[p];
+    if (merged[p] != _undef_) {
+      repl[p] = Subst(merged[p]);
+      continue;
+    }
+    if (Bin_p(f)) {
+      Formula l = Subst(left(f)), r = Subst(right(f));
+      repl[p] = (l == left(f) && r == right(f)) ? f
+                : (op(f) == op_And)             ? l & r
+                                                : ~(l ^ r);
+    } else if (ITE_p(f)) {
+      Formula c = Subst(cond(f)), a = Subst(tt(f)), b = Subst(ff(f));
+      repl[p] = (c == cond(f) && a == tt(f) && b == ff(f)) ? f : ITE(c, a, b);
+    } else {
+      Formula x = Subst(FA_x(f)), y = Subst(FA_y(f)), c = Subst(FA_c(f));
+      repl[p] = (x == FA_x(f) && y == FA_y(f) && c == FA_c(f)) ? f
+                : isCarry(f)                                  ? FAc(x, y, c)
+                                                              : FAs(x, y, c);
+    }
+  }
+
+  time_left -= Minisat::cpuTime() - start;
+
+  bool ok = true;
+  int j = 0;
+  for (int i = 0; i < (int)fs.size(); i++) {
+    Formula f = Subst(fs[i]);
+    if (f == _0_) ok = false;
+    if (f != _1_) fs[j++] = f;
+  }
+  fs.resize(j);
+#undef Subst
+
+  if (opt_verbosity >= 1) {
+    if (n_checks == 0)
+      reportf("  -- Sweeping: (none)  (%d nodes)\n", (int)sw.order.size());
+    else
+      reportf("  -- Sweeping: %d of %d nodes merged  (%d refuted, %d undecided%s)\n",
+              n_merged, (int)sw.order.size(), n_refuted, n_undecided, out_of_time ? ", out of time" : "");
+  }
+  return ok;
+}
@@ -57,14 +57,20 @@ bool opt_convert_weak = true;
 double opt_bdd_thres = 3;
 double opt_sort_thres = 20;
 double opt_goal_bias = 3;
+double opt_probe_time = 1;
+double opt_sweep_time = 0;
 Int opt_goal = Int_MAX;
 Command opt_command = cmd_Minimize;
 bool opt_branch_pbvars = false;
 int opt_polarity_sug = 1;
 bool opt_old_format = false;
+int opt_parse_threads = 1;
+bool opt_parse_pipeline = false;
 
 char* opt_input = NULL;
 char* opt_result = NULL;
+char* opt_save_snapshot = NULL;
+char* opt_load_snapshot = NULL;
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 //- - - - - - - - - -
@@ -77,6 +83,7 @@ cchar* doc =
     "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~"
     "~~~~~\n"
     "USAGE: minisatp <input-file> [<result-file>] [-<option> ...]\n"
+    "       minisatp -load-snapshot=<file> [<result-file>] [-<option> ...]\n"
     "\n"
     "Solver options:\n"
     "  -ca -adders   Convert PB-constrs to clauses through adders.\n"
@@ -95,6 +102,10 @@ cchar* doc =
     "%g]\n"
     "  -goal-bias=   Bias goal function convertion towards sorters.     [def: "
     "%g]\n"
+    "  -probe-time=  Seconds of failed literal probing (0 = off).       [def: "
+    "%g]\n"
+    "  -sweep-time=  Seconds of merging equivalent nodes, in total.     [def: "
+    "%g]\n"
     "\n"
     "  -1 -first     Don\'t minimize, just give first solution found\n"
     "  -A -all       Don\'t minimize, give all solutions\n"
@@ -107,6 +118,14 @@ cchar* doc =
     "\n"
     "Input options:\n"
     "  -of -old-fmt  Use old variant of OPB file format.\n"
+    "  -parse-threads=<n>\n"
+    "                Parse constraints on <n> threads (regular files).  [def: "
+    "%d]\n"
+    "  -parse-pipe   Normalize constraints on a second thread while parsing.\n"
+    "  -save-snapshot=<file>\n"
+    "                Save the normalized problem to a binary snapshot.\n"
+    "  -load-snapshot=<file>\n"
+    "                Read the problem from a snapshot instead of parsing.\n"
     "\n"
     "Output options:\n"
     "  -s -satlive   Turn off SAT competition output.\n"
@@ -139,6 +158,21 @@ bool oneof(cchar* arg, cchar* alternatives) {
   return false;
 }
 
+// Does 'name' start like a problem (OPB text, compressed input or a snapshot) rather than a
+// result file? Catches an input file given together with '-load-snapshot'.
+static bool looksLikeProblem(cchar* name) {
+  FILE* in = fopen(name, "rb");
+  if (in == NULL) return false;
+  char head[6] = {0};
+  size_t n = fread(head, 1, sizeof(head), in);
+  fclose(in);
+  return (n >= 1 && head[0] == '*') || (n >= 4 && strncmp(head, "min:", 4) == 0) ||
+         (n >= 2 && memcmp(head, "\x1F\x8B", 2) == 0) ||             // (gzip)
+         (n >= 6 && memcmp(head, "\xFD" "7zXZ\0", 6) == 0) ||        // (xz)
+         (n >= 4 && memcmp(head, "\x28\xB5\x2F\xFD", 4) == 0) ||   // (zstd)
+         (n >= 6 && strncmp(head, "PBSNAP", 6) == 0);
+}
+
 void parseOptions(int argc, char** argv) {
   vector<char*> args;  // Non-options
 
@@ -146,7 +180,8 @@ void parseOptions(int argc, char** argv) {
     char* arg = argv[i];
     if (arg[0] == '-') {
       if (oneof(arg, "h,help"))
-        fprintf(stderr, doc, opt_bdd_thres, opt_sort_thres, opt_goal_bias),
+        fprintf(stderr, doc, opt_bdd_thres, opt_sort_thres, opt_goal_bias,
+                opt_probe_time, opt_sweep_time, opt_parse_threads),
             exit(0);
 
       else if (oneof(arg, "ca,adders"))
@@ -179,10 +214,20 @@ void parseOptions(int argc, char** argv) {
         opt_sort_thres = atof(arg + 12);
       else if (strncmp(arg, "-goal-bias=", 11) == 0)
         opt_goal_bias = atof(arg + 11);
+      else if (strncmp(arg, "-probe-time=", 12) == 0)
+        opt_probe_time = atof(arg + 12);
+      else if (strncmp(arg, "-sweep-time=", 12) == 0)
+        opt_sweep_time = atof(arg + 12);
       else if (strncmp(arg, "-goal=", 6) == 0)
-        opt_goal = atoi(arg + 6);  // <<== real bignum parsing here
+        opt_goal = Int(arg + 6);
       else if (strncmp(arg, "-cnf=", 5) == 0)
         opt_cnf = arg + 5;
+      else if (strncmp(arg, "-parse-threads=", 15) == 0)
+        opt_parse_threads = max(atoi(arg + 15), 1);
+      else if (strncmp(arg, "-save-snapshot=", 15) == 0)
+        opt_save_snapshot = arg + 15;
+      else if (strncmp(arg, "-load-snapshot=", 15) == 0)
+        opt_load_snapshot = arg + 15;
       //(end)
 
       else if (oneof(arg, "1,first"))
@@ -201,6 +246,8 @@ void parseOptions(int argc, char** argv) {
 
       else if (oneof(arg, "of,old-fmt"))
         opt_old_format = true;
+      else if (oneof(arg, "parse-pipe"))
+        opt_parse_pipeline = true;
 
       else if (oneof(arg, "s,satlive"))
         opt_satlive = false;
@@ -223,8 +270,19 @@ void parseOptions(int argc, char** argv) {
       args.push_back(arg);
   }
 
-  if (args.size() == 0)
-    fprintf(stderr, doc, opt_bdd_thres, opt_sort_thres, opt_goal_bias), exit(0);
+  if (args.size() == 0 && opt_load_snapshot == NULL)
+    fprintf(stderr, doc, opt_bdd_thres, opt_sort_thres, opt_goal_bias,
+            opt_probe_time, opt_sweep_time, opt_parse_threads),
+        exit(0);
+  if (opt_load_snapshot != NULL) {
+    if (args.size() >= 1 && looksLikeProblem(args[0]))
+      fprintf(stderr,
+              "ERROR! '%s' looks like an input file; with -load-snapshot the problem\n"
+              "       is read from the snapshot, so leave the input file out.\n",
+              args[0]),
+          exit(1);
+    args.insert(args.begin(), opt_load_snapshot);
+  }
   if (args.size() >= 1) opt_input = args[0];
   if (args.size() == 2)
     opt_result = args[1];
@@ -347,8 +405,15 @@ int main(int argc, char** argv)
           opt_command = cmd_FirstSolution;
     }
 
-    if (opt_verbosity >= 1) reportf("Parsing PB file...\n");
-    parse_PB_file(opt_input, pb_solver, true);
+    if (opt_load_snapshot != NULL) {
+      if (opt_verbosity >= 1) reportf("Loading snapshot...\n");
+      if (!pb_solver.loadSnapshot(opt_load_snapshot))
+        reportf("ERROR! Could not read snapshot: %s\n", opt_load_snapshot),
+            exit(1);
+    } else {
+      if (opt_verbosity >= 1) reportf("Parsing PB file...\n");
+      parse_PB_file(opt_input, pb_solver, true);
+    }
     pb_solver.solve(convert(opt_command));
 
     if (pb_solver.goal == NULL && pb_solver.best_goalvalue != Int_MAX)
@@ -52,14 +52,22 @@ extern bool opt_convert_weak;
 extern double opt_bdd_thres;
 extern double opt_sort_thres;
 extern double opt_goal_bias;
+extern double opt_probe_time;
+extern double opt_sweep_time;
 extern Int opt_goal;
 extern Command opt_command;
 extern bool opt_branch_pbvars;
 extern int opt_polarity_sug;
 
+// -- input options:
+extern int opt_parse_threads;
+extern bool opt_parse_pipeline;
+
 // -- files:
 extern char* opt_input;
 extern char* opt_result;
+extern char* opt_save_snapshot;
+extern char* opt_load_snapshot;
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 //- - - - - - - - - -
@@ -19,24 +19,265 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include "PbParser.h"
 #include "File.h"
+#include "StringArena.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <zlib.h>
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 
 //=================================================================================================
 // Parser buffers (streams):
 
 
-class FileBuffer {
-    File    in;
-    int     next;
+/*
+Input streams (pipes, compressed files) are read by a 'Decoder' on a background thread, which
+fills two blocks in turn: while the parser consumes one block, the next one is being read and
+decompressed. The format is selected from the first bytes of the stream (see 'detectFormat()').
+*/
+
+enum StreamFormat { fmt_Plain, fmt_Gzip, fmt_Xz, fmt_Zstd };
+
+#define StreamFormat_MagicSize 6
+
+static StreamFormat detectFormat(cchar* head, int size) {
+    const uchar* h = (const uchar*)head;
+    if (size >= 2 && h[0] == 0x1F && h[1] == 0x8B)                                   return fmt_Gzip;
+    if (size >= 6 && h[0] == 0xFD && memcmp(h + 1, "7zXZ", 4) == 0 && h[5] == 0x00) return fmt_Xz;
+    if (size >= 4 && h[0] == 0x28 && h[1] == 0xB5 && h[2] == 0x2F && h[3] == 0xFD)   return fmt_Zstd;
+    return fmt_Plain; }
+
+
+#define Decoder_InSize (64 * 1024)
+
+class Decoder {
+protected:
+    int     fd;
+    uchar   in_buf[Decoder_InSize];
+    int     in_size;                // Number of bytes in 'in_buf' (0 = end of input).
+    int     in_pos;                 // Number of bytes consumed from 'in_buf'.
+    bool    in_eof;
+
+    // Refills 'in_buf' if everything has been consumed. Returns FALSE at end of input.
+    bool fill() {
+        if (in_pos < in_size) return true;
+        if (in_eof) return false;
+        ssize_t n;
+        do n = ::read(fd, in_buf, Decoder_InSize); while (n < 0 && errno == EINTR);
+        if (n <= 0){ in_eof = true; in_size = in_pos = 0; return false; }
+        in_size = (int)n, in_pos = 0;
+        return true; }
+
+    // Result of a 'decode()' call that wrote 'n' bytes: data decoded before an error is still
+    // returned; the error is reported by the next call.
+    int result(int n) const { return (n == 0 && error != NULL) ? -1 : n; }
+
+public:
+    cchar*  error;                  // Set when 'decode()' returns -1.
+
+    Decoder(int fd_, cchar* head, int head_size) : fd(fd_), in_size(head_size), in_pos(0), in_eof(false), error(NULL) {
+        memcpy(in_buf, head, head_size); }
+    virtual ~Decoder() {}
+
+    // Fills 'out' with up to 'cap' bytes of decoded data. Returns the number of bytes written, 0 at end
+    // of stream, and -1 on errors (once all data before the error has been returned).
+    virtual int decode(uchar* out, int cap) = 0;
+};
+
+
+class PlainDecoder : public Decoder {
+public:
+    PlainDecoder(int fd, cchar* head, int head_size) : Decoder(fd, head, head_size) {}
+    int decode(uchar* out, int cap) {
+        if (!fill()) return 0;
+        int n = min(cap, in_size - in_pos);
+        memcpy(out, in_buf + in_pos, n);
+        in_pos += n;
+        return n; }
+};
+
+
+class GzipDecoder : public Decoder {
+    z_stream    z;
+    bool        done;
+public:
+    GzipDecoder(int fd, cchar* head, int head_size) : Decoder(fd, head, head_size), done(false) {
+        memset(&z, 0, sizeof(z));
+        if (inflateInit2(&z, 15 + 32) != Z_OK) error = "Could not initialize gzip decompression.", done = true; }
+   ~GzipDecoder() { inflateEnd(&z); }
+    int decode(uchar* out, int cap) {
+        if (error != NULL) return -1;
+        z.next_out  = out;
+        z.avail_out = cap;
+        while (z.avail_out > 0 && !done){
+            if (!fill()){
+                if (z.total_in != 0) error = "Unexpected end of gzip input.";
+                done = true; break; }
+            z.next_in  = in_buf + in_pos;
+            z.avail_in = in_size - in_pos;
+            int ret = inflate(&z, Z_NO_FLUSH);
+            in_pos = in_size - z.avail_in;
+            if (ret == Z_STREAM_END){
+                inflateReset(&z);       // (more gzip members may follow)
+                z.total_in = 0;
+                if (!fill()) done = true;
+            }else if (ret != Z_OK && ret != Z_BUF_ERROR){
+                error = "Corrupt gzip input.";
+                break; }
+        }
+        return result(cap - z.avail_out); }
+};
+
+
+#ifdef HAVE_LZMA
+class XzDecoder : public Decoder {
+    lzma_stream s;
+    bool        done;
+public:
+    XzDecoder(int fd, cchar* head, int head_size) : Decoder(fd, head, head_size), done(false) {
+        lzma_stream init = LZMA_STREAM_INIT;
+        s = init;
+        if (lzma_stream_decoder(&s, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) error = "Could not initialize xz decompression.", done = true; }
+   ~XzDecoder() { lzma_end(&s); }
+    int decode(uchar* out, int cap) {
+        if (error != NULL) return -1;
+        s.next_out  = out;
+        s.avail_out = cap;
+        while (s.avail_out > 0 && !done && error == NULL){
+            bool more = fill();
+            s.next_in  = in_buf + in_pos;
+            s.avail_in = in_size - in_pos;
+            lzma_ret ret = lzma_code(&s, more ? LZMA_RUN : LZMA_FINISH);
+            in_pos = in_size - s.avail_in;
+            if      (ret == LZMA_STREAM_END) done = true;
+            else if (ret != LZMA_OK)         error = (ret == LZMA_BUF_ERROR) ? "Unexpected end of xz input." : "Corrupt xz input.";
+        }
+        return result(cap - s.avail_out); }
+};
+#endif
+
+
+#ifdef HAVE_ZSTD
+class ZstdDecoder : public Decoder {
+    ZSTD_DStream*   ds;
+    size_t          pending;        // Last return value of 'ZSTD_decompressStream()' (0 = at frame boundary).
+public:
+    ZstdDecoder(int fd, cchar* head, int head_size) : Decoder(fd, head, head_size), pending(0) {
+        ds = ZSTD_createDStream();
+        if (ds == NULL || ZSTD_isError(ZSTD_initDStream(ds))) error = "Could not initialize zstd decompression."; }
+   ~ZstdDecoder() { ZSTD_freeDStream(ds); }
+    int decode(uchar* out, int cap) {
+        if (error != NULL) return -1;
+        ZSTD_outBuffer o = { out, (size_t)cap, 0 };
+        while (o.pos < o.size){
+            if (!fill()){
+                if (pending != 0) error = "Unexpected end of zstd input.";
+                break; }
+            ZSTD_inBuffer i = { in_buf, (size_t)in_size, (size_t)in_pos };
+            pending = ZSTD_decompressStream(ds, &o, &i);
+            in_pos = (int)i.pos;
+            if (ZSTD_isError(pending)){ error = "Corrupt zstd input."; break; }
+        }
+        return result((int)o.pos); }
+};
+#endif
+
+
+#define StreamBuffer_BlockSize (1024 * 1024)
+
+class StreamBuffer {
+    int                     fd;
+    Decoder*                decoder;
+    uchar*                  block[2];
+    int                     block_size[2];  // Bytes decoded into block (0 = end of stream, -1 = error).
+    bool                    full[2];        // Block is owned by the parser (otherwise by the worker).
+    bool                    stop;
+    std::mutex              lock;
+    std::condition_variable changed;
+    std::thread             worker;
+    int                     cur;            // Block being parsed (-1 before the first block).
+    uchar*                  ptr;
+    uchar*                  last;
+
+    void work() {
+        for (int w = 0;; w ^= 1){
+            {   std::unique_lock<std::mutex> guard(lock);
+                while (full[w] && !stop) changed.wait(guard);
+                if (stop) return; }
+            int n = decoder->decode(block[w], StreamBuffer_BlockSize);
+            {   std::lock_guard<std::mutex> guard(lock);
+                block_size[w] = n;
+                full[w] = true; }
+            changed.notify_all();
+            if (n <= 0) return;
+        } }
+
+    int refill() {      // Hand the current block back to the worker and wait for the next one.
+        if (cur != -1 && block_size[cur] <= 0){
+            if (block_size[cur] < 0) throw xstrdup(decoder->error);
+            return EOF; }
+        std::unique_lock<std::mutex> guard(lock);
+        if (cur != -1){
+            full[cur] = false;
+            changed.notify_all(); }
+        cur = (cur + 1) & 1;
+        while (!full[cur]) changed.wait(guard);
+        ptr  = block[cur];
+        last = block[cur] + max(block_size[cur], 0);
+        if (block_size[cur] <= 0){
+            if (block_size[cur] < 0) throw xstrdup(decoder->error);
+            return EOF; }
+        return *ptr; }
+
 public:
     int     line;
-    FileBuffer(cchar* input_file) : in(input_file, "rb") {
-        if (in.null()) reportf("ERROR! Could not open file for reading: %s\n", input_file), exit(0);
-        next = in.getCharQ();
-        line = 1; }
-   ~FileBuffer() {}
-    int  operator *  () { return next; }
-    void operator ++ () { if (next == '\n') line++; next = in.getCharQ(); }
+    StreamBuffer(cchar* input_file) : fd(-1), decoder(NULL), stop(false), cur(-1), ptr(NULL), last(NULL), line(1) {
+        fd = open64(input_file, O_RDONLY);
+        if (fd == -1) reportf("ERROR! Could not open file for reading: %s\n", input_file), exit(0);
+
+        char    head[StreamFormat_MagicSize];
+        int     head_size = 0;
+        for (ssize_t n; head_size < StreamFormat_MagicSize; head_size += (int)n){
+            n = ::read(fd, head + head_size, StreamFormat_MagicSize - head_size);
+            if (n < 0 && errno == EINTR){ n = 0; continue; }
+            if (n <= 0) break; }
+
+        switch (detectFormat(head, head_size)){
+        case fmt_Plain: decoder = new PlainDecoder(fd, head, head_size); break;
+        case fmt_Gzip:  decoder = new GzipDecoder (fd, head, head_size); break;
+      #ifdef HAVE_LZMA
+        case fmt_Xz:    decoder = new XzDecoder   (fd, head, head_size); break;
+      #endif
+      #ifdef HAVE_ZSTD
+        case fmt_Zstd:  decoder = new ZstdDecoder (fd, head, head_size); break;
+      #endif
+        default:
+            reportf("ERROR! Compressed input format not supported by this build: %s\n", input_file), exit(0); }
+
+        for (int i = 0; i < 2; i++)
+            block[i] = new uchar[StreamBuffer_BlockSize], block_size[i] = 0, full[i] = false;
+        worker = std::thread(&StreamBuffer::work, this); }
+
+   ~StreamBuffer() {
+        {   std::lock_guard<std::mutex> guard(lock);
+            stop = true; }
+        changed.notify_all();
+        worker.join();
+        delete decoder;
+        for (int i = 0; i < 2; i++) delete [] block[i];
+        ::close(fd); }
+
+    int  operator *  () { return (ptr < last) ? *ptr : refill(); }
+    void operator ++ () { if (*ptr == '\n') line++; ++ptr; }
 };
 
 
@@ -45,14 +286,107 @@ class StringBuffer {
     cchar*  last;
 public:
     int     line;
-    StringBuffer(cchar* text)           { ptr = text; last = ptr + strlen(text); line = 1; }
-    StringBuffer(cchar* text, int size) { ptr = text; last = ptr + size; line = 1; }
+    StringBuffer(cchar* text)              { ptr = text; last = ptr + strlen(text); line = 1; }
+    StringBuffer(cchar* text, size_t size) { ptr = text; last = ptr + size; line = 1; }
    ~StringBuffer() {}
-    int  operator *  () { return (ptr >= last) ? EOF : *ptr; }
+    int  operator *  () { return (ptr >= last) ? EOF : (uchar)*ptr; }
     void operator ++ () { if (*ptr == '\n') line++; ++ptr; }
+
+    // Direct access for the scanning fast paths below:
+    cchar* pos() const { return ptr; }
+    cchar* end() const { return last; }
+    void   seek(cchar* p) { ptr = p; }      // (caller updates 'line' if newlines are skipped)
 };
 
 
+//=================================================================================================
+// Character scanning for contiguous buffers:
+
+
+/*
+'scan<C>(p, end)' returns a pointer to the first character in '[p, end)' not in character class
+'C' (or 'end'). Full vectors are tested 32 (AVX2) or 16 (SSE2) bytes at a time; the tail, and
+builds without SSE2, use the scalar test. Bytes >= 128 are negative in the signed compares below,
+so they fall outside every class, just like in the scalar tests.
+*/
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  typedef __m256i Chars;
+  #define Chars_Width             32
+  #define Chars_All               0xFFFFFFFFu
+  #define Chars_load(p)           _mm256_loadu_si256((const __m256i*)(p))
+  #define Chars_set(c)            _mm256_set1_epi8(c)
+  #define Chars_eq(x, y)          _mm256_cmpeq_epi8(x, y)
+  #define Chars_gt(x, y)          _mm256_cmpgt_epi8(x, y)
+  #define Chars_or(x, y)          _mm256_or_si256(x, y)
+  #define Chars_and(x, y)         _mm256_and_si256(x, y)
+  #define Chars_mask(x)           (uint)_mm256_movemask_epi8(x)
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+  typedef __m128i Chars;
+  #define Chars_Width             16
+  #define Chars_All               0xFFFFu
+  #define Chars_load(p)           _mm_loadu_si128((const __m128i*)(p))
+  #define Chars_set(c)            _mm_set1_epi8(c)
+  #define Chars_eq(x, y)          _mm_cmpeq_epi8(x, y)
+  #define Chars_gt(x, y)          _mm_cmpgt_epi8(x, y)
+  #define Chars_or(x, y)          _mm_or_si128(x, y)
+  #define Chars_and(x, y)         _mm_and_si128(x, y)
+  #define Chars_mask(x)           (uint)_mm_movemask_epi8(x)
+#endif
+
+#ifdef Chars_Width
+macro Chars Chars_range(Chars x, char lo, char hi) {
+    return Chars_and(Chars_gt(x, Chars_set(lo - 1)), Chars_gt(Chars_set(hi + 1), x)); }
+#endif
+
+struct Blank {      // not including newline
+    static bool has(uchar c) { return c == ' ' || c == '\t'; }
+  #ifdef Chars_Width
+    static Chars has(Chars x) { return Chars_or(Chars_eq(x, Chars_set(' ')), Chars_eq(x, Chars_set('\t'))); }
+  #endif
+};
+
+struct Digit {
+    static bool has(uchar c) { return c >= '0' && c <= '9'; }
+  #ifdef Chars_Width
+    static Chars has(Chars x) { return Chars_range(x, '0', '9'); }
+  #endif
+};
+
+struct IdentChar {
+    static bool has(uchar c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'; }
+  #ifdef Chars_Width
+    static Chars has(Chars x) {
+        return Chars_or(Chars_or(Chars_range(x, 'a', 'z'), Chars_range(x, 'A', 'Z')),
+                        Chars_or(Chars_range(x, '0', '9'), Chars_eq(x, Chars_set('_')))); }
+  #endif
+};
+
+template<class C>
+static inline cchar* scan(cchar* p, cchar* end) {
+    if (p < end && !C::has((uchar)*p)) return p;    // (most runs are short or empty)
+  #ifdef Chars_Width
+    while (end - p >= Chars_Width){
+        uint mask = ~Chars_mask(C::has(Chars_load(p))) & Chars_All;
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += Chars_Width; }
+  #endif
+    while (p < end && C::has((uchar)*p)) p++;
+    return p; }
+
+// Value of the 'n' (1..8) decimal digits at 'p'; 8 bytes must be readable from 'p'. The digits are
+// combined pairwise inside one 64-bit word (little endian), without a multiply per digit.
+static inline uint parseDigits8(cchar* p, int n) {
+    uint64 x;
+    memcpy(&x, p, 8);
+    x = (x & 0x0F0F0F0F0F0F0F0FULL) << (8 * (8 - n));   // (leading zero digits shifted in)
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x * 10000 + (x >> 32)) & 0x00000000FFFFFFFFULL;
+    return (uint)x; }
+
 
 //=================================================================================================
 // PB Parser:
@@ -91,6 +425,9 @@ static void skipWhitespace(B& in) {     // not including newline
     while (*in == ' ' || *in == '\t')
         ++in; }
 
+static void skipWhitespace(StringBuffer& in) {
+    in.seek(scan<Blank>(in.pos(), in.end())); }
+
 template<class B>
 static void skipLine(B& in) {
     for (;;){
@@ -98,6 +435,11 @@ static void skipLine(B& in) {
         if (*in == '\n') { ++in; return; }
         ++in; } }
 
+static void skipLine(StringBuffer& in) {
+    cchar* p = (cchar*)memchr(in.pos(), '\n', in.end() - in.pos());    // (vectorized by libc)
+    if (p == NULL) in.seek(in.end());
+    else           in.seek(p + 1), in.line++; }
+
 template<class B>
 static void skipComments(B& in) {      // skip comment and empty lines (assuming we are at beginning of line)
     while (*in == '*' || *in == '\n') skipLine(in); }
@@ -117,8 +459,25 @@ static bool skipText(B& in, cchar* text) {
     return true; }
 
 template<class B>
-static Int parseInt(B& in) {
+static Int parseDigits(B& in) {
     Int     val(0);
+    while (*in >= '0' && *in <= '9'){
+        val *= 10;          // (becomes a bignum when needed)
+        val += (*in - '0');
+        ++in; }
+    return val; }
+
+static Int parseDigits(StringBuffer& in) {
+    cchar* p = in.pos();
+    cchar* q = scan<Digit>(p, in.end());
+    int    n = (int)(q - p);
+    if (n > 8 || in.end() - p < 8)
+        return parseDigits<StringBuffer>(in);   // (long numbers or end of buffer)
+    in.seek(q);
+    return Int((int)parseDigits8(p, n)); }
+
+template<class B>
+static Int parseInt(B& in) {
     bool    neg = false;
     skipWhitespace(in);
     if      (*in == '-') neg = true, ++in;
@@ -126,16 +485,7 @@ static Int parseInt(B& in) {
     skipWhitespace(in);     // BE NICE: allow "- 3" and "+  4" etc.
     if (*in < '0' || *in > '9')
         throw nsprintf("Expected digit, not: %c", *in);
-    while (*in >= '0' && *in <= '9'){
-      #ifdef NO_GMP
-        val *= 2;
-        if (val < 0 || val > Int(9223372036854775807LL >> 20)) throw xstrdup("Integer overflow. Use BigNum-version.");      // (20 extra bits should be enough...)
-        val *= 5;
-      #else
-        val *= 10;
-      #endif
-        val += (*in - '0');
-        ++in; }
+    Int val = parseDigits(in);
     return neg ? -val : val; }
 
 template<class B>
@@ -151,6 +501,16 @@ static cchar* parseIdent(B& in, vector<char>& tmp) {   // 'tmp' is cleared, then
     tmp.push_back(0);
     return &(tmp[0]); }
 
+static cchar* parseIdent(StringBuffer& in, vector<char>& tmp) {
+    skipWhitespace(in);
+    if ((*in < 'a' || *in > 'z') && (*in < 'A' || *in > 'Z') && *in != '_') throw nsprintf("Expected start of identifier, not: %c", *in);
+    cchar* p = in.pos();
+    cchar* q = scan<IdentChar>(p + 1, in.end());
+    tmp.assign(p, q);
+    tmp.push_back(0);
+    in.seek(q);
+    return &(tmp[0]); }
+
 
 template<class B, class S>
 void parseExpr(B& in, S& solver, vector<Lit>& out_ps, vector<Int>& out_Cs, vector<char>& tmp, bool old_format)
@@ -183,11 +543,11 @@ void parseSize(B& in, S& solver)
     skipWhitespace(in);
 
     if (!skipText(in, "#variable=")) goto Abort;
-    n_vars = parseInt(in);
+    n_vars = (int)parseInt(in);
 
     skipWhitespace(in);
     if (!skipText(in, "#constraint=")) goto Abort;
-    n_constrs = parseInt(in);
+    n_constrs = (int)parseInt(in);
 
     solver.allocConstrs(n_vars, n_constrs);
 
@@ -265,10 +625,289 @@ bool parseConstrs(B& in, S& solver, bool old_format)
 }
 
 
+//=================================================================================================
+// Parallel parsing:
+
+
+/*
+The constraint section of a mapped file is split at line boundaries (a constraint never spans
+more than one line) into chunks, which are parsed on a small pool of threads. Variable names are
+interned in 'ShardedNames', which hands out provisional ids. The chunks are then fed to the
+solver in file order, and provisional ids are translated through 'getVar()' at their first
+occurrence -- so variables are numbered exactly as by the sequential parser.
+*/
+
+#define ShardedNames_Shards 64      // (power of two)
+
+class ShardedNames {
+    struct Shard {
+        std::mutex          lock;
+        Map<cchar*, int>    name2id;
+        vector<cchar*>      names;      // local index -> name
+    };
+    Shard   shards[ShardedNames_Shards];
+
+    static uint shardOf(cchar* name) {
+        uint h = Hash<cchar*>()(name) * 0x9E3779B1u;
+        return (h >> 16) % ShardedNames_Shards; }
+
+public:
+   ~ShardedNames() {
+        for (int s = 0; s < ShardedNames_Shards; s++)
+            for (size_t i = 0; i < shards[s].names.size(); i++)
+                delete [] shards[s].names[i]; }
+
+    // Returns a provisional id for 'name' (same interface as the solver's 'getVar()').
+    int getVar(cchar* name) {
+        uint   s = shardOf(name);
+        Shard& sh = shards[s];
+        std::lock_guard<std::mutex> guard(sh.lock);
+        int ret;
+        if (!sh.name2id.peek(name, ret)){
+            ret = (int)(sh.names.size() * ShardedNames_Shards + s);
+            sh.names.push_back(xstrdup(name));
+            sh.name2id.set(sh.names.back(), ret); }
+        return ret; }
+
+    cchar* name(int id) const {
+        return shards[id % ShardedNames_Shards].names[id / ShardedNames_Shards]; }
+};
+
+
+struct ParsedChunk {
+    cchar*      begin;
+    cchar*      end;
+    vector<Lit> ps;             // Terms of all constraints (variables are provisional ids).
+    vector<Int> Cs;
+    vector<int> sizes;          // Number of terms of each constraint.
+    vector<int> ineqs;
+    vector<Int> rhss;
+    vector<cchar*> new_names;   // (pipelined parsing only) Variables first used in this chunk.
+    cchar*      error;          // Parse error (or NULL); raised after adding the constraints before it.
+    int         error_line;     // (relative to 'begin')
+    ParsedChunk() : begin(NULL), end(NULL), error(NULL), error_line(0) {}
+};
+
+
+static void parseChunk(ParsedChunk& chunk, ShardedNames& names, bool old_format)
+{
+    StringBuffer in(chunk.begin, chunk.end - chunk.begin);
+    vector<Lit> ps; vector<Int> Cs; vector<char> tmp;
+    try{
+        skipComments(in);
+        while (*in != EOF){
+            parseExpr(in, names, ps, Cs, tmp, old_format);
+            int ineq = parseInequality(in);
+            Int rhs  = parseInt(in);
+
+            skipWhitespace(in);
+            if (!skipText(in, ";")) throw xstrdup("Expecting ';' after constraint.");
+            skipEndOfLine(in);
+
+            chunk.ps.insert(chunk.ps.end(), ps.begin(), ps.end());
+            chunk.Cs.insert(chunk.Cs.end(), Cs.begin(), Cs.end());
+            chunk.sizes.push_back((int)ps.size());
+            chunk.ineqs.push_back(ineq);
+            chunk.rhss .push_back(rhs);
+            ps.clear();
+            Cs.clear();
+        }
+    }catch (cchar* msg){
+        chunk.error      = msg;
+        chunk.error_line = in.line;
+    }
+}
+
+
+template<class S>
+bool parseConstrsParallel(StringBuffer& in, S& solver, bool old_format, int n_threads, int& err_line)
+{
+    // Split remaining input at line boundaries:
+    cchar*  start    = in.pos();
+    cchar*  end      = in.end();
+    size_t  len      = end - start;
+    int     n_chunks = min((int)(len / (256 * 1024)) + 1, n_threads * 8);
+    vector<ParsedChunk> chunks(n_chunks);
+    cchar*  p = start;
+    for (int i = 0; i < n_chunks; i++){
+        chunks[i].begin = p;
+        cchar* q = (i == n_chunks-1) ? end : start + len / n_chunks * (i+1);
+        if (q < p) q = p;
+        while (q < end && q[-1] != '\n') q++;
+        chunks[i].end = p = q;
+    }
+
+    // Parse chunks on a pool of threads:
+    ShardedNames        names;
+    std::atomic<int>    next(0);
+    vector<std::thread> pool;
+    for (int t = 0; t < n_threads; t++)
+        pool.push_back(std::thread([&](){
+            for (int i; (i = next++) < n_chunks;)
+                parseChunk(chunks[i], names, old_format); }));
+    for (int t = 0; t < n_threads; t++)
+        pool[t].join();
+
+    // Add constraints in file order:
+    vector<int> id2var;
+    vector<Lit> ps; vector<Int> Cs;
+    for (int i = 0; i < n_chunks; i++){
+        ParsedChunk& c = chunks[i];
+        int k = 0;
+        for (size_t j = 0; j < c.sizes.size(); j++){
+            for (int n = 0; n < c.sizes[j]; n++, k++){
+                int id = var(c.ps[k]);
+                if (id >= (int)id2var.size()) id2var.resize(id + 1, -1);
+                if (id2var[id] == -1) id2var[id] = solver.getVar(names.name(id));
+                ps.push_back(mkLit(id2var[id], sign(c.ps[k])));
+                Cs.push_back(c.Cs[k]);
+            }
+            if (!solver.addConstr(ps, Cs, c.rhss[j], c.ineqs[j]))
+                return false;
+            ps.clear();
+            Cs.clear();
+        }
+        vector<Lit>().swap(c.ps);
+        vector<Int>().swap(c.Cs);
+
+        if (c.error != NULL){
+            err_line = in.line + (int)std::count(start, c.begin, '\n') + c.error_line - 1;
+            throw c.error;
+        }
+    }
+    return true;
+}
+
+
+//=================================================================================================
+// Pipelined parsing:
+
+
+/*
+The parser runs on a thread of its own and hands over batches of constraints ('ParsedChunk') to
+the calling thread through a lock-free queue; the calling thread normalizes and stores them
+('addConstr()'), in file order. The parser cannot touch the solver, so it numbers the variables
+itself, continuing from the variables the solver already has. The calling thread creates the
+solver variables of 'new_names' in order and translates the numbers (as 'parseConstrsParallel()'
+does).
+*/
+
+#define Pipeline_BatchSize  1024    // Constraints per batch.
+#define Pipeline_QueueSize  64      // Batches in flight.
+
+class PipelineSink {        // (the 'S' of 'parseConstrs()' on the parser thread)
+    Map<cchar*, int>            name2id;
+    StringArena                 name_mem;
+    int                         n_ids;
+    SpscQueue<ParsedChunk*>&    queue;
+
+public:
+    ParsedChunk*    batch;
+
+    PipelineSink(const vector<cchar*>& names, SpscQueue<ParsedChunk*>& q) :
+        n_ids(names.size()), queue(q), batch(new ParsedChunk) {
+        for (int i = 0; i < n_ids; i++) name2id.set(names[i], i); }
+   ~PipelineSink() { delete batch; }
+
+    int getVar(cchar* name) {
+        int ret;
+        if (!name2id.peek(name, ret)){
+            cchar* copy = name_mem.add(name);
+            ret = n_ids++;
+            name2id.set(copy, ret);
+            batch->new_names.push_back(copy); }
+        return ret; }
+
+    bool addConstr(const vector<Lit>& ps, const vector<Int>& Cs, Int rhs, int ineq) {
+        batch->ps.insert(batch->ps.end(), ps.begin(), ps.end());
+        batch->Cs.insert(batch->Cs.end(), Cs.begin(), Cs.end());
+        batch->sizes.push_back((int)ps.size());
+        batch->ineqs.push_back(ineq);
+        batch->rhss .push_back(rhs);
+        if (batch->sizes.size() >= Pipeline_BatchSize) push(), batch = new ParsedChunk;
+        return !queue.isCancelled(); }
+
+    // Hands 'batch' over to the consumer (NULL marks the end). The consumer owns it afterwards.
+    void push() {
+        if (!queue.push(batch)) delete batch;
+        batch = NULL; }
+};
+
+
+template<class B>
+static void parseBatches(B& in, PipelineSink& sink, bool old_format)
+{
+    try{
+        parseConstrs(in, sink, old_format);
+    }catch (cchar* msg){
+        sink.batch->error      = msg;
+        sink.batch->error_line = in.line;
+    }
+    if (!sink.batch->sizes.empty() || !sink.batch->new_names.empty() || sink.batch->error != NULL)
+        sink.push();
+    else
+        delete sink.batch, sink.batch = NULL;
+    sink.push();        // (end marker)
+}
+
+
+template<class B>
+bool parseConstrsPipelined(B& in, PbSolver& solver, bool old_format, int& err_line)
+{
+    SpscQueue<ParsedChunk*> queue(Pipeline_QueueSize);
+    PipelineSink            sink(solver.index2name, queue);
+    std::thread             parser([&](){ parseBatches(in, sink, old_format); });
+
+    bool        ok = true;
+    cchar*      error = NULL;
+    vector<int> id2var;         // (ids below the solver's variables at the start are the same)
+    for (int i = 0; i < (int)solver.index2name.size(); i++) id2var.push_back(i);
+    vector<Lit> ps; vector<Int> Cs;
+    for (ParsedChunk* c;;){
+        queue.pop(c);
+        if (c == NULL) break;
+
+        for (size_t i = 0; i < c->new_names.size(); i++)
+            id2var.push_back(solver.getVar(c->new_names[i]));
+        int k = 0;
+        for (size_t j = 0; j < c->sizes.size() && ok; j++){
+            for (int n = 0; n < c->sizes[j]; n++, k++){
+                ps.push_back(mkLit(id2var[var(c->ps[k])], sign(c->ps[k])));
+                Cs.push_back(c->Cs[k]); }
+            ok = solver.addConstr(ps, Cs, c->rhss[j], c->ineqs[j]);
+            ps.clear();
+            Cs.clear();
+        }
+        if (ok && c->error != NULL)
+            error = c->error, err_line = c->error_line;
+        delete c;
+        if (!ok){ queue.cancel(); break; }
+    }
+    parser.join();
+
+    for (ParsedChunk* c; queue.tryPop(c);)      // (left behind after a conflict)
+        delete c;
+    if (error != NULL) throw error;
+    return ok;
+}
+
+
 //=================================================================================================
 // Main parser functions:
 
 
+static void parseError(int line, cchar* msg, bool abort_on_error)
+{
+    if (abort_on_error){
+        reportf("PARSE ERROR! [line %d] %s\n", line, msg);
+        // xfree(msg);
+        if (opt_satlive && !opt_try)
+            printf("s UNKNOWN\n");
+        exit(5);
+    }else
+        throw msg;
+}
+
 template<class B, class S>
 static bool parse_PB(B& in, S& solver, bool old_format, bool abort_on_error)
 {
@@ -277,24 +916,59 @@ static bool parse_PB(B& in, S& solver, bool old_format, bool abort_on_error)
         parseGoal(in, solver, old_format);
         return parseConstrs(in, solver, old_format);
     }catch (cchar* msg){
-        if (abort_on_error){
-            reportf("PARSE ERROR! [line %d] %s\n", in.line, msg);
-            // xfree(msg);
-            if (opt_satlive && !opt_try)
-                printf("s UNKNOWN\n");
-            exit(5);
-        }else
-            throw msg;
+        parseError(in.line, msg, abort_on_error);
+        return false;
     }
+}
 
+template<class B>
+static bool parse_PB_pipelined(B& in, PbSolver& solver, bool old_format, bool abort_on_error)
+{
+    int err_line = -1;
+    try{
+        parseSize(in, solver);
+        parseGoal(in, solver, old_format);
+        return parseConstrsPipelined(in, solver, old_format, err_line);
+    }catch (cchar* msg){
+        parseError(err_line == -1 ? in.line : err_line, msg, abort_on_error);
+        return false;
+    }
+}
+
+template<class S>
+static bool parse_PB_parallel(StringBuffer& in, S& solver, bool old_format, bool abort_on_error, int n_threads)
+{
+    int err_line = -1;
+    try{
+        parseSize(in, solver);
+        parseGoal(in, solver, old_format);
+        return parseConstrsParallel(in, solver, old_format, n_threads, err_line);
+    }catch (cchar* msg){
+        parseError(err_line == -1 ? in.line : err_line, msg, abort_on_error);
+        return false;
+    }
 }
 
 // PB parser functions: Returns TRUE if successful, FALSE if conflict detected during parsing.
 // If 'abort_on_error' is false, a 'cchar*' error message may be thrown.
 //
 void parse_PB_file(cchar* filename, PbSolver& solver, bool old_format, bool abort_on_error) {
-    FileBuffer buf(filename);
-    parse_PB(buf, solver, old_format, abort_on_error); }
+    MappedFile file(filename);
+    if (!file.null() && detectFormat(file.data(), (int)min(file.size(), (size_t)StreamFormat_MagicSize)) == fmt_Plain){
+        StringBuffer buf(file.data(), file.size());
+        if (opt_parse_threads > 1)
+            parse_PB_parallel(buf, solver, old_format, abort_on_error, opt_parse_threads);
+        else if (opt_parse_pipeline)
+            parse_PB_pipelined(buf, solver, old_format, abort_on_error);
+        else
+            parse_PB(buf, solver, old_format, abort_on_error);
+        return; }
+    file.close();
+    StreamBuffer buf(filename);     // (pipes and compressed files are streamed instead)
+    if (opt_parse_pipeline)
+        parse_PB_pipelined(buf, solver, old_format, abort_on_error);
+    else
+        parse_PB(buf, solver, old_format, abort_on_error); }
 
 //=================================================================================================
 // Debug:
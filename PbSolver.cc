@@ -31,55 +31,74 @@ SOFTWARE.
 #include "Debug.h"
 #include "Sort.h"
 #include "minisat/utils/System.h"
-#include <iostream>     
-#include <sstream>
 
 using namespace std;
 
 extern int verbosity;
 
-char*toString(Int &x){
-     std::stringstream stream;
-     stream<<x;
-     string str=stream.str();
-     char *re=new char[str.size()+1];
-
-     size_t i=0;
-     for(;i< str.size();  i++){
-       re[i]=str[i];
-     }
-     re[i]='\0';
-     return re;
-
-}
 //=================================================================================================
 // Interface required by parser:
 
+// Returns 'N' if 'name' is of the form "x<N>" (no leading zeros) and 'N < limit', else -1.
+static int numericName(cchar* name, int limit) {
+  if (name[0] != 'x' || name[1] < '0' || name[1] > '9' ||
+      (name[1] == '0' && name[2] != 0))
+    return -1;
+  int64 n = 0;
+  for (cchar* p = name + 1; *p != 0; p++) {
+    if (*p < '0' || *p > '9') return -1;
+    n = n * 10 + (*p - '0');
+    if (n >= limit) return -1;
+  }
+  return (int)n;
+}
+
 int PbSolver::getVar(cchar* name) {
   int ret;
-  if (!name2index.peek(name, ret)) {
-    // Create new variable:
-    Var x = index2name.size();
-    index2name.push_back(xstrdup(name));
-    n_occurs.push_back(0);
-    n_occurs.push_back(0);
-    // assigns   .push(toInt(l_Undef));
-    sat_solver.newVar();  // (reserve one SAT variable for each PB variable)
-    ret = name2index.set(index2name.back(), x);
-  }
-  return ret;
+  int num = numericName(name, num_limit);
+  if (num >= 0) {
+    if (num >= (int)num2index.size())
+      num2index.resize(std::max(num + 1, (int)num2index.size() * 2), -1);
+    if (num2index[num] != -1) return num2index[num];
+  } else if (name2index.peek(name, ret))
+    return ret;
+
+  // Create new variable:
+  Var x = index2name.size();
+  index2name.push_back(name_mem.add(name));
+  n_occurs.push_back(0);
+  n_occurs.push_back(0);
+  // assigns   .push(toInt(l_Undef));
+  sat_solver.newVar();  // (reserve one SAT variable for each PB variable)
+  if (num >= 0)
+    num2index[num] = x;
+  else
+    name2index.set(index2name.back(), x);
+  return x;
 }
 
 void PbSolver::allocConstrs(int n_vars, int n_constrs) {
   declared_n_vars = n_vars;
   declared_n_constrs = n_constrs;
+
+  // Pre-size variable tables from the header (which is only a hint). The numeric range must
+  // not change once variables exist, or "x<N>" could end up with two indices.
+  if (n_vars > 0 && n_vars < PbSolver_MaxNumLimit) {
+    if (index2name.size() == 0) {
+      num_limit = std::max(num_limit, std::min(2 * n_vars, PbSolver_MaxNumLimit));
+      num2index.resize(n_vars + 1, -1);
+    }
+    index2name.reserve(n_vars);
+    n_occurs.reserve(2 * n_vars);
+  }
+  if (n_constrs > 0 && n_constrs < PbSolver_MaxNumLimit) constrs.reserve(n_constrs);
 }
 
 void PbSolver::addGoal(const vector<Lit>& ps, const vector<Int>& Cs) {
   /**/ debug_names = &index2name;
   //**/reportf("MIN: "); dump(ps, Cs); reportf("\n");
 
-  goal = new      Linear(ps, Cs, Int_MIN, Int_MAX);
+  goal = Linear_new(ps, Cs, Int_MIN, Int_MAX);
 }
 
 bool PbSolver::addConstr(const vector<Lit>& ps, const vector<Int>& Cs, Int rhs,
@@ -89,8 +108,6 @@ bool PbSolver::addConstr(const vector<Lit>& ps, const vector<Int>& Cs, Int rhs,
   //**/reportf("CONSTR: "); dump(ps, Cs, assigns); reportf(" %s ",
   //ineq_name[ineq+2]); dump(rhs); reportf("\n");
 
-  vector<Lit> norm_ps;
-  vector<Int> norm_Cs;
   Int norm_rhs;
 
 #define Copy                                              \
@@ -130,7 +147,7 @@ bool PbSolver::addConstr(const vector<Lit>& ps, const vector<Int>& Cs, Int rhs,
       CopyInv;
       ineq = -ineq;
     }
-    if (ineq == 2) ++norm_rhs;
+    if (ineq == 2) norm_rhs += 1;
 
     if (normalizePb(norm_ps, norm_Cs, norm_rhs))
       storePb(norm_ps, norm_Cs, norm_rhs, Int_MAX);  //**/reportf("STORED: "),
@@ -190,38 +207,55 @@ bool PbSolver::normalizePb(vector<Lit>& ps, vector<Int>& Cs, Int& C) {
 
   // Group all x/~x pairs
   //
-  Map<Var, Pair<Int, Int> > var2consts(
-      Pair_new(0, 0));  // Variable -> negative/positive polarity constant
+  if (++norm_epoch == 0) {  // (wrapped around -- forget all old stamps)
+    for (size_t i = 0; i < norm_stamp.size(); i++) norm_stamp[i] = 0;
+    norm_epoch = 1;
+  }
+  if (norm_stamp.size() < (size_t)nVars())
+    norm_stamp.resize(nVars(), 0), norm_index.resize(nVars());
+  norm_consts.clear();
   for (size_t i = 0; i < ps.size(); i++) {
     Var x = var(ps[i]);
-    Pair<Int, Int> consts = var2consts.at(x);
+    if (norm_stamp[x] != norm_epoch) {
+      norm_stamp[x] = norm_epoch;
+      norm_index[x] = norm_consts.size();
+      norm_consts.push_back(Pair_new(x, Pair_new(Int(0), Int(0))));
+    }
+    Pair<Int, Int>& consts = norm_consts[norm_index[x]].snd;
     if (sign(ps[i]))
       consts.fst += Cs[i];
     else
       consts.snd += Cs[i];
-    var2consts.set(x, consts);
   }
 
   // Normalize constants to positive values only:
   //
-  vector<Pair<Var, Pair<Int, Int> > > all;
-  var2consts.pairs(all);
-  vector<Pair<Int, Lit> > Csps(all.size());
+  vector<Pair<Var, Pair<Int, Int> > >& all = norm_consts;
+  vector<Pair<Int, Lit> >& Csps = norm_Csps;
+  Csps.resize(all.size());
+  int n_terms = 0;
   for (size_t i = 0; i < all.size(); i++) {
+    if (all[i].snd.fst == all[i].snd.snd) {
+      // Both polarities vanish ('x' and '~x' with equal constants)
+      C -= all[i].snd.fst;
+      continue;
+    }
+    Pair<Int, Lit>& term = Csps[n_terms++];
     if (all[i].snd.fst < all[i].snd.snd) {
       // Negative polarity will vanish
       C -= all[i].snd.fst;
-      Csps[i] = Pair_new(all[i].snd.snd - all[i].snd.fst, mkLit(all[i].fst));
+      term = Pair_new(all[i].snd.snd - all[i].snd.fst, mkLit(all[i].fst));
     } else {
       // Positive polarity will vanish
       C -= all[i].snd.snd;
-      Csps[i] = Pair_new(all[i].snd.fst - all[i].snd.snd, ~mkLit(all[i].fst));
+      term = Pair_new(all[i].snd.fst - all[i].snd.snd, ~mkLit(all[i].fst));
     }
   }
+  Csps.resize(n_terms);
 
   // Sort literals on growing constant values:
   //
-  sort(Csps);  // (use lexicographical order of 'Pair's here)
+  if (Csps.size() > 0) sort(Csps);  // (use lexicographical order of 'Pair's here)
   Int sum = 0;
   for (size_t i = 0; i < Csps.size(); i++) {
     Cs[i] = Csps[i].fst, ps[i] = Csps[i].snd, sum += Cs[i];
@@ -283,8 +317,8 @@ void PbSolver::storePb(const vector<Lit>& ps, const vector<Int>& Cs, Int lo,
                        Int hi) {
   assert(ps.size() == Cs.size());
   for (size_t i = 0; i < ps.size(); i++) n_occurs[toInt(ps[i])]++;
-  constrs.push_back(
-      new           Linear(ps, Cs, lo, hi));
+  constrs.push_back(constr_mem.alloc(ps, Cs, lo, hi));
+  if (occur_start.size() > 0) addOccurs(constrs.size() - 1);
   //**/reportf("STORED: "), dump(constrs.last()), reportf("\n");
 }
 
@@ -303,7 +337,7 @@ bool PbSolver::propagate(Linear& c) {
     assert(c(i) > 0);
     if (value(c[i]) == l_Undef) {
       sum += c(i);
-      c(j) = c(i);
+      c.setCoef(j, c(i));
       c[j] = c[i];
       j++;
     } else if (value(c[i]) == l_True)
@@ -341,64 +375,360 @@ bool PbSolver::propagate(Linear& c) {
     return c.lo == Int_MIN && c.hi == Int_MAX;
 }
 
+// Unit propagation to fixpoint. Each constraint keeps 'Slack' counters that
+// are updated in constant time per assigned literal through the occur lists;
+// only constraints whose slack drops below their largest undecided coefficient
+// are looked at. Afterwards the touched constraints are compacted by
+// 'propagate(Linear&)', which may find units the SAT solver assigned behind
+// our back, in which case the whole thing is repeated.
 void PbSolver::propagate() {
   if (nVars() == 0) return;
-  if (occur.size() == 0) setupOccurs();
 
   if (opt_verbosity >= 1) reportf("  -- Unit propagations: ", constrs.size());
+  bool found = propagateAll(opt_verbosity >= 1);
+
+  if (opt_verbosity >= 1 && okay()) {
+    if (!found)
+      reportf("(none)\n");
+    else
+      reportf("\n");
+  }
+}
+
+// Returns TRUE if any units were found. If 'report' is set, a "p" is printed
+// for every constraint that propagated something.
+bool PbSolver::propagateAll(bool report) {
+  if (occur_start.size() == 0) setupOccurs();
   bool found = false;
+  do {
+    // Counters take every assignment so far into account:
+    slack.resize(constrs.size());
+    for (int i = 0; i < constrs.size(); i++)
+      if (constrs[i] != LRef_Undef) initSlack(i);
+    propQ_head = trail.size();
+    for (int i = 0; i < constrs.size(); i++) {
+      if (constrs[i] == LRef_Undef) continue;
+      int trail_sz = trail.size();
+      if (!propagateSlack(i)) return true;
+      if (trail.size() > trail_sz) {
+        found = true;
+        if (report) reportf("p");
+      }
+    }
 
-  while (propQ_head < trail.size()) {
-    //**/reportf("propagate("); dump(trail[propQ_head]); reportf(")\n");
-    Var x = var(trail[propQ_head++]);
-    for (int pol = 0; pol < 2; pol++) {
-      vector<int>& cs = occur[toInt(mkLit(x, pol))];
-      for (size_t i = 0; i < cs.size(); i++) {
-        if (constrs[cs[i]] == NULL) continue;
-        int trail_sz = trail.size();
-        if (propagate(*constrs[cs[i]])) constrs[cs[i]] = NULL;
-        if (opt_verbosity >= 1 && trail.size() > trail_sz)
-          found = true, reportf("p");
-        if (!okay()) return;
+    while (propQ_head < trail.size()) {
+      int trail_sz = trail.size();
+      if (!updateSlack(trail[propQ_head++])) return true;
+      if (trail.size() > trail_sz) {
+        found = true;
+        if (report) reportf("p");
+      }
+    }
+
+    // Remove assigned literals:
+    for (int i = 0; i < constrs.size(); i++) {
+      if (constrs[i] == LRef_Undef || !slack[i].touched) continue;
+      int trail_sz = trail.size();
+      if (propagate(constr_mem[constrs[i]])) constrs[i] = LRef_Undef;
+      if (trail.size() > trail_sz) {
+        found = true;
+        if (report) reportf("p");
+      }
+      if (!okay()) return true;
+    }
+  } while (propQ_head < trail.size());
+  slack.clear();
+  return found;
+}
+
+void PbSolver::initSlack(int i) {
+  const Linear& c = constr_mem[constrs[i]];
+  Slack& s = slack[i];
+  Int sum = 0, true_sum = 0;
+  s.touched = false;
+  for (int j = 0; j < c.size; j++) {
+    lbool v = value(c[j]);
+    if (v != l_False) sum += c(j);
+    if (v == l_True) true_sum += c(j);
+    if (v != l_Undef) s.touched = true;
+  }
+  s.has_lo = c.lo != Int_MIN;
+  s.has_hi = c.hi != Int_MAX;
+  s.lo = s.has_lo ? sum - c.lo : Int(0);
+  s.hi = s.has_hi ? c.hi - true_sum : Int(0);
+  s.top = c.size - 1;
+  s.max_coef = c.size > 0 ? c(c.size - 1) : Int(0);
+}
+
+// Updates the counters for 'p' having become true and propagates the
+// constraints whose slack got too small. On conflict, the remaining counters
+// are still updated (so that 'revertSlack()' can undo them) and FALSE is
+// returned.
+bool PbSolver::updateSlack(Lit p) {
+  bool ok = true;
+  for (int pol = 0; pol < 2; pol++) {
+    int q = toInt(pol == 0 ? p : ~p);  // ('p' is true, '~p' is false)
+    for (int k = occur_start[q]; k < occur_end[q]; k++) {
+      int i = occur[k];
+      if (constrs[i] == LRef_Undef) continue;
+      Slack& s = slack[i];
+      if (!probing) s.touched = true;
+      if (pol == 0) {
+        s.hi -= occur_coef[k];
+        if (!s.has_hi || s.hi >= s.max_coef) continue;
+      } else {
+        s.lo -= occur_coef[k];
+        if (!s.has_lo || s.lo >= s.max_coef) continue;
+      }
+      if (ok && !propagateSlack(i)) ok = false;
+    }
+  }
+  return ok;
+}
+
+void PbSolver::revertSlack(Lit p) {
+  for (int pol = 0; pol < 2; pol++) {
+    int q = toInt(pol == 0 ? p : ~p);
+    for (int k = occur_start[q]; k < occur_end[q]; k++) {
+      int i = occur[k];
+      if (constrs[i] == LRef_Undef) continue;
+      if (pol == 0)
+        slack[i].hi += occur_coef[k];
+      else
+        slack[i].lo += occur_coef[k];
+    }
+  }
+}
+
+// Assigns every undecided literal of constraint 'i' whose coefficient exceeds
+// a slack (coefficients are sorted, so those are found from the top). Returns
+// FALSE on conflict.
+bool PbSolver::propagateSlack(int i) {
+  const Linear& c = constr_mem[constrs[i]];
+  Slack& s = slack[i];
+  if ((s.has_lo && s.lo < 0) || (s.has_hi && s.hi < 0)) {
+    if (!probing) sat_solver.addEmptyClause();
+    return false;
+  }
+  int top = s.top;
+  while (s.top >= 0 && pbValue(c[s.top]) != l_Undef) s.top--;
+  if (probing && s.top != top) probe_tops.push_back(Pair_new(i, top));
+  s.max_coef = s.top >= 0 ? c(s.top) : Int(0);
+
+  for (int j = s.top; j >= 0; j--) {
+    Int cj = c(j);
+    bool up = s.has_lo && cj > s.lo;
+    bool down = s.has_hi && cj > s.hi;
+    if (!up && !down) break;
+    if (pbValue(c[j]) != l_Undef) continue;
+    if (up && down) {
+      if (!probing) sat_solver.addEmptyClause();
+      return false;
+    }
+    Lit q = up ? c[j] : ~c[j];
+    if (probing) {
+      probe_assigns[var(q)] = lbool(!sign(q));
+      probe_trail.push_back(q);
+      probe_indirect.push_back(probe_head > 1);
+    } else if (!addUnit(q))
+      return false;
+  }
+  return true;
+}
+
+//=================================================================================================
+// Failed literal probing:
+
+struct ProbeOrder_lt {
+  const vector<int>& occs;
+  const vector<Int>& weight;
+  ProbeOrder_lt(const vector<int>& o, const vector<Int>& w)
+      : occs(o), weight(w) {}
+  bool operator()(Var x, Var y) const {
+    return occs[x] > occs[y] || (occs[x] == occs[y] && weight[x] > weight[y]);
+  }
+};
+
+// Tentatively assigns 'p' and propagates (without touching the SAT solver).
+// Returns FALSE if that gives a conflict. The implied literals are left in
+// 'probe_trail' until 'undoProbe()'.
+bool PbSolver::probeLit(Lit p) {
+  probing = true;
+  probe_assigns[var(p)] = lbool(!sign(p));
+  probe_trail.push_back(p);
+  probe_indirect.push_back(false);
+  bool ok = true;
+  for (probe_head = 0; ok && probe_head < probe_trail.size();)
+    ok = updateSlack(probe_trail[probe_head++]);
+  probing = false;
+  return ok;
+}
+
+void PbSolver::undoProbe() {
+  for (int k = probe_head - 1; k >= 0; k--) revertSlack(probe_trail[k]);
+  for (int k = 0; k < probe_trail.size(); k++)
+    probe_assigns[var(probe_trail[k])] = l_Undef;
+  for (int k = probe_tops.size() - 1; k >= 0; k--) {
+    int i = probe_tops[k].fst;
+    Slack& s = slack[i];
+    s.top = probe_tops[k].snd;
+    s.max_coef = s.top >= 0 ? constr_mem[constrs[i]](s.top) : Int(0);
+  }
+  probe_trail.clear();
+  probe_indirect.clear();
+  probe_tops.clear();
+  probe_head = 0;
+}
+
+bool PbSolver::propagateUnits() {
+  while (propQ_head < trail.size())
+    if (!updateSlack(trail[propQ_head++])) return false;
+  return true;
+}
+
+// Probes both polarities of the variables (most occurring first, then by goal
+// weight) until 'opt_probe_time' seconds have passed. A literal whose probe
+// fails is fixed to false, a literal implied by both polarities is fixed to
+// true, and implications found through more than one constraint are added as
+// binary clauses (at most one per probed variable).
+void PbSolver::probe() {
+  if (nVars() == 0 || !okay()) return;
+  double deadline = Minisat::cpuTime() + opt_probe_time;
+  if (occur_start.size() == 0) setupOccurs();
+
+  slack.resize(constrs.size());
+  for (int i = 0; i < constrs.size(); i++)
+    if (constrs[i] != LRef_Undef) initSlack(i);
+  propQ_head = trail.size();
+  probe_assigns.assign(nVars(), l_Undef);
+
+  vector<int> occs(nVars(), 0);
+  vector<Int> weight(nVars(), 0);
+  for (int p = 0; p < nVars() * 2; p++)
+    occs[p >> 1] += occur_end[p] - occur_start[p];
+  if (goal != NULL)
+    for (int i = 0; i < goal->size; i++)
+      weight[var((*goal)[i])] = (*goal)(i) < 0 ? -(*goal)(i) : (*goal)(i);
+  vector<Var> order;
+  for (Var x = 0; x < nVars(); x++)
+    if (value(x) == l_Undef && occs[x] > 0) order.push_back(x);
+  if (order.size() > 0) sort(order, ProbeOrder_lt(occs, weight));
+
+  int n_failed = 0, n_implied = 0, n_probed = 0, units = trail.size();
+  vector<unsigned> mark(nVars() * 2, 0);  // Lit -> probe number that implied it
+  vector<Lit> both;
+  vector<Pair<Lit, Lit> > bins;
+  for (int k = 0; k < order.size() && okay(); k++) {
+    Var x = order[k];
+    if (value(x) != l_Undef) continue;
+    if (Minisat::cpuTime() > deadline) break;
+    n_probed++;
+
+    Lit p = mkLit(x);
+    both.clear();
+    bool has_bin = false;  // (at most one binary clause per probed variable)
+    for (int pol = 0; pol < 2; pol++, p = ~p) {
+      if (!probeLit(p)) {
+        undoProbe();
+        n_failed++;
+        if (addUnit(~p)) propagateUnits();
+        break;
+      }
+      for (int j = 1; j < probe_trail.size(); j++) {
+        Lit q = probe_trail[j];
+        if (pol == 0)
+          mark[toInt(q)] = n_probed;
+        else if (mark[toInt(q)] == n_probed)
+          both.push_back(q);
+        if (probe_indirect[j] && !has_bin)
+          bins.push_back(Pair_new(~p, q)), has_bin = true;
       }
+      undoProbe();
     }
+    for (int j = 0; j < both.size() && okay(); j++)
+      if (value(both[j]) == l_Undef) {
+        n_implied++;
+        if (addUnit(both[j])) propagateUnits();
+      }
   }
+  slack.clear();
+  probe_assigns.clear();
+
+  // Learned binary clauses (those of now fixed variables are dropped):
+  int n_bins = 0;
+  vector<Lit> ps(2);
+  vector<Int> Cs(2, 1);
+  for (int j = 0; j < bins.size() && okay(); j++) {
+    ps[0] = bins[j].fst, ps[1] = bins[j].snd;
+    if (value(ps[0]) != l_Undef || value(ps[1]) != l_Undef) continue;
+    storePb(ps, Cs, 1, Int_MAX);
+    n_bins++;
+  }
+  if (okay() && trail.size() > units) propagateAll(false);
 
   if (opt_verbosity >= 1) {
-    if (!found)
-      reportf("(none)\n");
+    if (n_failed + n_implied + n_bins == 0)
+      reportf("  -- Probing: (none)  (%d of %d variables probed)\n", n_probed,
+              order.size());
     else
-      reportf("\n");
+      reportf(
+          "  -- Probing: %d failed literals, %d implied units, %d binary "
+          "clauses  (%d of %d variables probed)\n",
+          n_failed, n_implied, n_bins, n_probed, order.size());
   }
-
-  occur.clear();
 }
 
+// Builds the occur lists by counting sort: the sizes are already known from
+// 'n_occurs', so one pass lays out the lists and a second one fills them.
 void PbSolver::setupOccurs() {
-  // Allocate vectors of right capacities:
-  occur.resize(nVars() * 2);
   assert(nVars() == pb_n_vars);
-  for (int i = 0; i < nVars() * 2; i++) {
-    occur[i].clear();
-    
-    // vector<int> tmp(n_occurs[i],n_occurs[i] );
-    // occur[i].swap(tmp);
-  
-    // vector<int> tmp(xmalloc<int>(n_occurs[i]), n_occurs[i]);
-    // tmp.clear();
-    // tmp.moveTo(occur[i]);
-  }
-
-  // Fill vectors:
-  for (int i = 0; i < constrs.size(); i++) {
-    if (constrs[i] == NULL) continue;
-    for (int j = 0; j < constrs[i]->size; j++)
-      assert(occur[toInt((*constrs[i])[j])].size() <
-             n_occurs[toInt((*constrs[i])[j])]),
-          occur[toInt((*constrs[i])[j])].push_back(i);
+  int n_lits = nVars() * 2;
+  occur_start.resize(n_lits + 1);
+  occur_end.resize(n_lits);
+  int total = 0;
+  for (int p = 0; p < n_lits; p++)
+    occur_start[p] = occur_end[p] = total, total += n_occurs[p];
+  occur_start[n_lits] = total;
+  occur.resize(total);
+  occur_coef.resize(total);
+
+  for (int i = 0; i < constrs.size(); i++)
+    if (constrs[i] != LRef_Undef) addOccurs(i);
+}
+
+// Adds constraint 'i' to the occur lists of its literals. A full list first
+// drops its entries of removed constraints; if that frees no slot (or the
+// literal is new), the lists are dropped and rebuilt on next use.
+void PbSolver::addOccurs(int i) {
+  const Linear& c = constr_mem[constrs[i]];
+  for (int j = 0; j < c.size; j++) {
+    int p = toInt(c[j]);
+    if (p < (int)occur_end.size() && occur_end[p] == occur_start[p + 1]) {
+      int k, l;
+      for (k = l = occur_start[p]; k < occur_end[p]; k++)
+        if (constrs[occur[k]] != LRef_Undef)
+          occur_coef[l] = occur_coef[k], occur[l++] = occur[k];
+      occur_end[p] = l;
+    }
+    if (p >= (int)occur_end.size() || occur_end[p] == occur_start[p + 1]) {
+      occur_start.clear();
+      occur_end.clear();
+      occur.clear();
+      occur_coef.clear();
+      return;
+    }
+  }
+  for (int j = 0; j < c.size; j++) {
+    int p = toInt(c[j]);
+    occur_coef[occur_end[p]] = c(j);
+    occur[occur_end[p]++] = i;
   }
 }
 
+void PbSolver::emptyOccurs() {
+  for (int p = 0; p < (int)occur_end.size(); p++) occur_end[p] = occur_start[p];
+}
+
 // Left-hand side equal
 static bool lhsEq(const Linear& c, const Linear& d) {
   if (c.size == d.size) {
@@ -418,49 +748,85 @@ static bool lhsEqc(const Linear& c, const Linear& d) {
     return false;
 }
 
+// Hash of the left-hand side. If 'negated' is TRUE, the hash of the left-hand side
+// with all literals negated is computed instead (negating the literals of a
+// normalized constraint does not change their order, so 'lhsEqc()' applies).
+static uint64 lhsHash(const Linear& c, bool negated) {
+  uint64 h = c.size;
+  for (int i = 0; i < c.size; i++) {
+    uint64 lit = toInt(c[i]) ^ (negated ? 1 : 0);
+    h = (h ^ (lit * 0x9E3779B97F4A7C15ULL + c(i).hash())) * 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+// Sum of coefficients:
+static Int lhsSum(const Linear& c) {
+  Int sum = 0;
+  for (int j = 0; j < c.size; j++) sum += c(j);
+  return sum;
+}
+
+// Merges all constraints with equal or complementary left-hand sides (wherever
+// they are in 'constrs') into one two-sided constraint, which takes the place
+// of the last of them. May find the problem unsatisfiable.
 void PbSolver::findIntervals() {
   if (opt_verbosity >= 1)
-    reportf("  -- Detecting intervals from adjacent constraints: ");
-
-  bool found = false;
-  int i = 0;
-  Linear* prev;
-  for (; i < constrs.size() && constrs[i] == NULL; i++)
-    ;
-  if (i < constrs.size()) {
-    prev = constrs[i++];
-    for (; i < constrs.size(); i++) {
-      if (constrs[i] == NULL) continue;
-      Linear& c = *prev;
-      Linear& d = *constrs[i];
-
-      if (lhsEq(c, d)) {
-        if (d.lo < c.lo) d.lo = c.lo;
-        if (d.hi > c.hi) d.hi = c.hi;
-        constrs[i - 1] = NULL;
-        if (opt_verbosity >= 1) reportf("=");
-        found = true;
-      }
-      if (lhsEqc(c, d)) {
-        Int sum = 0;
-        for (int j = 0; j < c.size; j++) sum += c(j);
-        Int lo = (c.hi == Int_MAX) ? Int_MIN : sum - c.hi;
-        Int hi = (c.lo == Int_MIN) ? Int_MAX : sum - c.lo;
-        if (d.lo < lo) d.lo = lo;
-        if (d.hi > hi) d.hi = hi;
-        constrs[i - 1] = NULL;
-        if (opt_verbosity >= 1) reportf("#");
-        found = true;
+    reportf("  -- Merging constraints with equal left-hand sides: ");
+
+  int n_equal = 0, n_compl = 0;
+  Map<uint64, int> first;    // LHS hash -> last constraint with that hash
+  vector<int> next(constrs.size(), -1);  // Constraint -> previous one with same hash
+  for (size_t i = 0; i < constrs.size() && okay(); i++) {
+    if (constrs[i] == LRef_Undef) continue;
+    Linear& d = constr_mem[constrs[i]];
+    uint64 h = lhsHash(d, false);
+    uint64 hc = lhsHash(d, true);
+
+    for (int pass = 0; pass < 2; pass++) {
+      int j;
+      if (!first.peek(pass == 0 ? h : hc, j)) continue;
+      for (; j != -1; j = next[j]) {
+        if (constrs[j] == LRef_Undef) continue;
+        Linear& c = constr_mem[constrs[j]];
+        if (pass == 0 && lhsEq(c, d)) {
+          if (d.lo < c.lo) d.lo = c.lo;
+          if (d.hi > c.hi) d.hi = c.hi;
+          n_equal++;
+        } else if (pass == 1 && lhsEqc(c, d)) {
+          Int sum = lhsSum(c);
+          Int lo = (c.hi == Int_MAX) ? Int_MIN : sum - c.hi;
+          Int hi = (c.lo == Int_MIN) ? Int_MAX : sum - c.lo;
+          if (d.lo < lo) d.lo = lo;
+          if (d.hi > hi) d.hi = hi;
+          n_compl++;
+        } else
+          continue;
+        constrs[j] = LRef_Undef;
       }
+    }
 
-      prev = &d;
+    // Tidy up the (possibly merged) interval:
+    Int sum = lhsSum(d);
+    if (d.lo != Int_MIN && d.lo <= 0) d.lo = Int_MIN;
+    if (d.hi != Int_MAX && d.hi >= sum) d.hi = Int_MAX;
+    if ((d.lo != Int_MIN && (d.lo > sum || (d.hi != Int_MAX && d.lo > d.hi))) ||
+        (d.hi != Int_MAX && d.hi < 0))
+      sat_solver.addEmptyClause();
+    else if (d.lo == Int_MIN && d.hi == Int_MAX)
+      constrs[i] = LRef_Undef;  // (trivially satisfied)
+    else {
+      int prev;
+      next[i] = first.peek(h, prev) ? prev : -1;
+      first.set(h, i);
     }
   }
   if (opt_verbosity >= 1) {
-    if (!found)
+    if (n_equal + n_compl == 0)
       reportf("(none)\n");
     else
-      reportf("\n");
+      reportf("%d equal, %d complementary\n", n_equal, n_compl);
   }
 }
 
@@ -473,8 +839,8 @@ bool PbSolver::rewriteAlmostClauses() {
 
   if (opt_verbosity >= 1) reportf("  -- Clauses(.)/Splits(s): ");
   for (int i = 0; i < constrs.size(); i++) {
-    if (constrs[i] == NULL) continue;
-    Linear& c = *constrs[i];
+    if (constrs[i] == LRef_Undef) continue;
+    Linear& c = constr_mem[constrs[i]];  // (NOTE! invalid after 'addConstr()')
     assert(c.lo != Int_MIN || c.hi != Int_MAX);
 
     if (c.hi != Int_MAX) continue;
@@ -491,7 +857,7 @@ bool PbSolver::rewriteAlmostClauses() {
       for (int j = n; j < c.size; j++) ps.push_back(c[j]);
       addClause(ps);
 
-      constrs[i] = NULL;  // Remove this clause
+      constrs[i] = LRef_Undef;  // Remove this clause
 
     } else if (c.size - n >= 3) {
       // Split clause part:
@@ -520,7 +886,7 @@ bool PbSolver::rewriteAlmostClauses() {
         return false;
       }
 
-      constrs[i] = NULL;  // Remove this clause
+      constrs[i] = LRef_Undef;  // Remove this clause
     }
   }
 
@@ -533,6 +899,594 @@ bool PbSolver::rewriteAlmostClauses() {
   return true;
 }
 
+//=================================================================================================
+// Equivalent literals:
+
+// If constraint 'c' has two literals and is equivalent to a clause, that clause
+// is stored in 'ps' (otherwise 'ps' is left empty).
+static void binaryClause(const Linear& c, vector<Lit>& ps) {
+  ps.clear();
+  if (c.size != 2) return;
+  if (c.lo != Int_MIN && c(0) >= c.lo && c(1) >= c.lo)
+    ps.push_back(c[0]), ps.push_back(c[1]);
+  else if (c.hi != Int_MAX && c(0) + c(1) > c.hi && c(0) <= c.hi && c(1) <= c.hi)
+    ps.push_back(~c[0]), ps.push_back(~c[1]);
+}
+
+// Implication graph of the binary clauses ('a | b' gives the edges '~a -> b'
+// and '~b -> a'), stored as for the occur lists: the successors of literal 'p'
+// are 'edges[start[p]]' up to (but not including) 'edges[start[p+1]]'.
+void PbSolver::implicationGraph(vector<int>& start, vector<int>& edges) {
+  int n_lits = nVars() * 2;
+  vector<Lit> ps;
+  start.assign(n_lits + 1, 0);
+  edges.clear();
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < constrs.size(); i++) {
+      if (constrs[i] == LRef_Undef) continue;
+      binaryClause(constr_mem[constrs[i]], ps);
+      if (ps.size() == 0) continue;
+      for (int k = 0; k < 2; k++) {
+        int from = toInt(~ps[k]);
+        if (pass == 0)
+          start[from]++;
+        else
+          edges[--start[from]] = toInt(ps[1 - k]);
+      }
+    }
+    if (pass == 0) {
+      for (int p = 0; p < n_lits; p++) start[p + 1] += start[p];
+      edges.resize(start[n_lits]);
+    }
+  }
+}
+
+// Finds the strongly connected components of the implication graph of all
+// binary clauses and replaces every variable of a component by one
+// representative (the one with the smallest index) in the constraints and the
+// goal. The replaced variables are recorded in 'subst' for 'extendModel()'.
+void PbSolver::substituteEquivalences() {
+  if (nVars() == 0 || !okay()) return;
+  int n_lits = nVars() * 2;
+
+  vector<int> start, edges;
+  implicationGraph(start, edges);
+  vector<Lit> ps;
+
+  // Tarjan's algorithm (without recursion):
+  vector<int> index(n_lits, -1), low(n_lits, 0);
+  vector<int> stack;
+  vector<char> on_stack(n_lits, 0);
+  vector<Pair<int, int> > calls;  // (literal, next edge)
+  vector<Lit> rep(n_lits, lit_Undef);
+  int n_index = 0;
+  for (int root = 0; root < n_lits && okay(); root++) {
+    if (index[root] != -1) continue;
+    calls.push_back(Pair_new(root, start[root]));
+    index[root] = low[root] = n_index++;
+    stack.push_back(root), on_stack[root] = 1;
+    while (calls.size() > 0) {
+      int v = calls.back().fst;
+      int e = calls.back().snd;
+      if (e < start[v + 1]) {
+        calls.back().snd++;
+        int w = edges[e];
+        if (index[w] == -1) {
+          calls.push_back(Pair_new(w, start[w]));
+          index[w] = low[w] = n_index++;
+          stack.push_back(w), on_stack[w] = 1;
+        } else if (on_stack[w])
+          low[v] = std::min(low[v], index[w]);
+        continue;
+      }
+      calls.pop_back();
+      if (calls.size() > 0)
+        low[calls.back().fst] = std::min(low[calls.back().fst], low[v]);
+      if (low[v] != index[v]) continue;
+
+      // Pop component:
+      int first = stack.size() - 1;
+      while (stack[first] != v) first--;
+      Lit r = toLit(stack[first]);
+      for (int k = first; k < stack.size(); k++)
+        if (var(toLit(stack[k])) < var(r)) r = toLit(stack[k]);
+      for (int k = first; k < stack.size(); k++) {
+        Lit p = toLit(stack[k]);
+        if (rep[toInt(~p)] != lit_Undef && rep[toInt(~p)] == r) {
+          sat_solver.addEmptyClause();  // ('p' and '~p' are equivalent)
+          break;
+        }
+        rep[toInt(p)] = r;
+        on_stack[stack[k]] = 0;
+      }
+      stack.resize(first);
+    }
+  }
+  if (!okay()) return;
+
+  int n_subst = 0;
+  for (Var x = 0; x < nVars(); x++) {
+    Lit r = rep[toInt(mkLit(x))];
+    if (r != lit_Undef && var(r) != x) {
+      if (subst.size() == 0) subst.resize(nVars(), lit_Undef);
+      subst[x] = r;
+      n_subst++;
+    }
+  }
+  if (n_subst == 0) {
+    if (opt_verbosity >= 1) reportf("  -- Equivalent literals: (none)\n");
+    return;
+  }
+
+  // Rewrite constraints (two-sided ones become two constraints again):
+  int n_rewritten = 0, n_constrs = constrs.size();
+  vector<Lit> qs;
+  vector<Int> Cs, Ds;
+  Int lo, hi, rhs;
+  for (int i = 0; i < n_constrs && okay(); i++) {
+    if (constrs[i] == LRef_Undef) continue;
+    const Linear& c = constr_mem[constrs[i]];
+    int j = 0;
+    while (j < c.size && (subst.size() <= var(c[j]) || subst[var(c[j])] == lit_Undef)) j++;
+    if (j == c.size) continue;
+
+    ps.clear(), Cs.clear();
+    for (j = 0; j < c.size; j++) {
+      Lit p = c[j];
+      if (var(p) < subst.size() && subst[var(p)] != lit_Undef)
+        p = subst[var(p)] ^ sign(p);
+      ps.push_back(p), Cs.push_back(c(j));
+    }
+    lo = c.lo, hi = c.hi;
+    constrs[i] = LRef_Undef;
+    n_rewritten++;
+
+    if (lo != Int_MIN) {
+      qs = ps, Ds = Cs, rhs = lo;
+      if (normalizePb(qs, Ds, rhs)) storePb(qs, Ds, rhs, Int_MAX);
+    }
+    if (hi != Int_MAX && okay()) {
+      qs = ps, rhs = -hi;
+      Ds.clear();
+      for (j = 0; j < Cs.size(); j++) Ds.push_back(-Cs[j]);
+      if (normalizePb(qs, Ds, rhs)) storePb(qs, Ds, rhs, Int_MAX);
+    }
+  }
+
+  // Rewrite goal (terms on the same literal are added up; the goal value
+  // itself must not change, so complementary terms are left alone):
+  if (goal != NULL && okay()) {
+    Map<int, int> at;  // Lit -> index in 'ps'
+    ps.clear(), Cs.clear();
+    for (int j = 0; j < goal->size; j++) {
+      Lit p = (*goal)[j];
+      if (var(p) < subst.size() && subst[var(p)] != lit_Undef)
+        p = subst[var(p)] ^ sign(p);
+      int k;
+      if (at.peek(toInt(p), k))
+        Cs[k] += (*goal)(j);
+      else
+        at.set(toInt(p), ps.size()), ps.push_back(p), Cs.push_back((*goal)(j));
+    }
+    Linear_delete(goal);
+    goal = Linear_new(ps, Cs, Int_MIN, Int_MAX);
+  }
+
+  if (okay()) propagateAll(false);
+
+  if (opt_verbosity >= 1)
+    reportf("  -- Equivalent literals: %d variables substituted, %d constraints rewritten\n",
+            n_subst, n_rewritten);
+}
+
+//=================================================================================================
+// Strengthening:
+
+// Strengthens the (one-sided) constraints in three ways:
+//
+//   - Saturation: no coefficient needs to be larger than the right-hand side.
+//   - Tightening: if the binary clauses guarantee that the other literals
+//     contribute at least 'm', no coefficient needs to be larger than
+//     'lo - m'. If 'm >= lo' already, the constraint is redundant.
+//   - Subsumption: 'C' (sum a_j*p_j >= lo) subsumes 'D' (sum d_j*p_j >= e) if
+//     every literal of 'C' is in 'D' with 'd_j >= min(a_j, e)', and 'e <= lo'.
+//
+// Binary clauses are only used as facts. They are never tightened, and are only
+// subsumed by other binary clauses, so the facts stay valid. Changed constraints are normalized and stored
+// again (their old occurrences then belong to a removed constraint).
+void PbSolver::strengthenConstraints() {
+  if (nVars() == 0 || !okay()) return;
+  int n_lits = nVars() * 2;
+  int n_saturated = 0, n_tightened = 0, n_redundant = 0, n_subsumed = 0;
+
+  vector<int> start, edges;
+  implicationGraph(start, edges);
+
+  vector<int> stamp(n_lits, -1);  // Lit -> constraint it was last seen in
+  vector<int> at(n_lits);         // Lit -> index in that constraint
+  vector<Int> pair_min;           // Index -> contribution of its matched pair
+  vector<Lit> ps;
+  vector<Int> Cs;
+  int n_constrs = constrs.size(), units = trail.size();
+  for (int i = 0; i < n_constrs && okay(); i++) {
+    if (constrs[i] == LRef_Undef) continue;
+    const Linear& c = constr_mem[constrs[i]];
+    if (c.lo == Int_MIN || c.hi != Int_MAX) continue;
+
+    // Greedy matching of literals (largest coefficients first) on binary clauses:
+    Int m = 0;
+    pair_min.assign(c.size, 0);
+    if (c.size >= 3 && edges.size() > 0) {
+      for (int j = 0; j < c.size; j++) stamp[toInt(c[j])] = i, at[toInt(c[j])] = j;
+      for (int j = c.size - 1; j >= 0; j--) {
+        if (pair_min[j] != 0) continue;
+        int q = toInt(~c[j]), best = -1;
+        for (int k = start[q]; k < start[q + 1]; k++) {
+          int r = edges[k];
+          if (stamp[r] == i && at[r] != j && pair_min[at[r]] == 0 &&
+              (best == -1 || at[r] > best))
+            best = at[r];
+        }
+        if (best != -1) {
+          Int min_coef = c(best) < c(j) ? c(best) : c(j);
+          pair_min[j] = pair_min[best] = min_coef;
+          m += min_coef;
+        }
+      }
+      if (m >= c.lo) {
+        constrs[i] = LRef_Undef;
+        n_redundant++;
+        continue;
+      }
+    }
+
+    bool changed = false;
+    for (int j = 0; j < c.size; j++) {
+      Int cap = c.lo - (m - pair_min[j]);
+      if (c(j) > c.lo) n_saturated++, changed = true;
+      else if (c(j) > cap) n_tightened++, changed = true;
+    }
+    if (!changed) continue;
+
+    ps.clear(), Cs.clear();
+    for (int j = 0; j < c.size; j++) {
+      Int cap = c.lo - (m - pair_min[j]);
+      ps.push_back(c[j]), Cs.push_back(c(j) > cap ? cap : c(j));
+    }
+    Int lo = c.lo;
+    constrs[i] = LRef_Undef;
+    if (normalizePb(ps, Cs, lo)) storePb(ps, Cs, lo, Int_MAX);
+  }
+  if (!okay()) return;
+  if (occur_start.size() == 0) setupOccurs();
+
+  // Subsumption (with a bound on the work, as occur lists can be long):
+  stamp.assign(n_lits, -1);
+  int64 work = 0, work_limit = 10 * (int64)occur.size() + 1000000;
+  for (int i = 0; i < constrs.size() && work < work_limit; i++) {
+    if (constrs[i] == LRef_Undef) continue;
+    const Linear& c = constr_mem[constrs[i]];
+    if (c.lo == Int_MIN || c.hi != Int_MAX || c.size == 0) continue;
+
+    int p = toInt(c[0]);
+    for (int j = 0; j < c.size; j++) {
+      int q = toInt(c[j]);
+      stamp[q] = i, at[q] = j;
+      if (occur_end[q] - occur_start[q] < occur_end[p] - occur_start[p]) p = q;
+    }
+    for (int k = occur_start[p]; k < occur_end[p]; k++) {
+      int i2 = occur[k];
+      if (i2 == i || constrs[i2] == LRef_Undef) continue;
+      const Linear& d = constr_mem[constrs[i2]];
+      if (d.hi != Int_MAX || d.lo == Int_MIN || d.lo > c.lo || d.size < c.size)
+        continue;
+      work += d.size;
+      int matched = 0;
+      for (int j = 0; j < d.size; j++) {
+        int q = toInt(d[j]);
+        if (stamp[q] != i) continue;
+        Int a = c(at[q]);
+        if (d(j) < (a < d.lo ? a : d.lo)) break;
+        matched++;
+      }
+      if (matched == c.size) {
+        constrs[i2] = LRef_Undef;
+        n_subsumed++;
+      }
+    }
+  }
+
+  if (trail.size() > units) propagateAll(false);
+
+  if (opt_verbosity >= 1) {
+    if (n_saturated + n_tightened + n_redundant + n_subsumed == 0)
+      reportf("  -- Strengthening: (none)\n");
+    else
+      reportf("  -- Strengthening: %d saturated, %d tightened, %d redundant, %d subsumed\n",
+              n_saturated, n_tightened, n_redundant, n_subsumed);
+  }
+}
+
+//=================================================================================================
+// Dominance:
+
+// Fixes literals that can be assumed without losing all optimal solutions
+// (not to be used when all solutions are wanted). A literal is "pure" if its
+// negation occurs in no constraint; making it true can then only help the
+// (one-sided) constraints. With 'cost[p]' the change of the goal when 'p' goes
+// from false to true:
+//
+//   - A pure literal 'p' with 'cost[p] <= 0' is set to true.
+//   - A pure literal 'q' with 'cost[q] > 0' is set to false if there is a pure
+//     literal 'p' with 'cost[p] <= cost[q]' that on its own satisfies every
+//     constraint 'q' is in (as in set covering: any solution with 'q' stays a
+//     solution, at no higher cost, with 'p' instead).
+void PbSolver::fixDominated() {
+  if (nVars() == 0 || !okay()) return;
+  if (occur_start.size() == 0) setupOccurs();
+  int n_lits = nVars() * 2;
+
+  vector<int> occs(n_lits, 0);  // Lit -> occurrences in live constraints
+  for (int i = 0; i < constrs.size(); i++) {
+    if (constrs[i] == LRef_Undef) continue;
+    const Linear& c = constr_mem[constrs[i]];
+    for (int j = 0; j < c.size; j++) {
+      occs[toInt(c[j])]++;
+      if (c.hi != Int_MAX) occs[toInt(~c[j])]++;  // (both polarities matter)
+    }
+  }
+  vector<Int> cost(n_lits, 0);
+  if (goal != NULL)
+    for (int j = 0; j < goal->size; j++)
+      cost[toInt((*goal)[j])] += (*goal)(j), cost[toInt(~(*goal)[j])] -= (*goal)(j);
+
+  int n_pure = 0, units = trail.size();
+  for (Var x = 0; x < nVars() && okay(); x++) {
+    if (value(x) != l_Undef || eliminated(x)) continue;
+    for (int pol = 0; pol < 2; pol++) {
+      Lit p = mkLit(x, pol);
+      if (occs[toInt(~p)] == 0 && cost[toInt(p)] <= 0 &&
+          (occs[toInt(p)] > 0 || cost[toInt(p)] < 0)) {
+        addUnit(p);
+        n_pure++;
+        break;
+      }
+    }
+  }
+
+  // Dominated literals (with a bound on the work):
+  int n_dominated = 0;
+  int64 work = 0, work_limit = 10 * (int64)occur.size() + 1000000;
+  vector<int> count(n_lits, 0), stamp(n_lits, -1);
+  vector<Lit> cands;
+  for (int q = 0; q < n_lits && okay() && work < work_limit; q++) {
+    Lit l = toLit(q);
+    if (occs[q] == 0 || occs[toInt(~l)] != 0 || cost[q] <= 0 || value(l) != l_Undef)
+      continue;
+
+    // Count, for each literal, the constraints of 'l' it satisfies on its own:
+    int n_constrs = 0;
+    cands.clear();
+    for (int k = occur_start[q]; k < occur_end[q]; k++) {
+      int i = occur[k];
+      if (constrs[i] == LRef_Undef) continue;
+      const Linear& c = constr_mem[constrs[i]];
+      work += c.size;
+      bool has_l = false;
+      for (int j = c.size - 1; j >= 0 && !has_l; j--) has_l = c[j] == l;
+      if (!has_l) continue;  // (stale occurrence)
+      n_constrs++;
+      for (int j = c.size - 1; j >= 0 && c(j) >= c.lo; j--) {
+        int p = toInt(c[j]);
+        if (stamp[p] != q) stamp[p] = q, count[p] = 0, cands.push_back(c[j]);
+        count[p]++;
+      }
+    }
+    for (int k = 0; k < cands.size(); k++) {
+      int p = toInt(cands[k]);
+      if (var(cands[k]) != var(l) && count[p] == n_constrs && occs[toInt(~cands[k])] == 0 &&
+          cost[p] <= cost[q] && value(cands[k]) == l_Undef) {
+        addUnit(~l);
+        n_dominated++;
+        break;
+      }
+    }
+  }
+
+  if (okay() && trail.size() > units) propagateAll(false);
+
+  if (opt_verbosity >= 1) {
+    if (n_pure + n_dominated == 0)
+      reportf("  -- Dominance: (none)\n");
+    else
+      reportf("  -- Dominance: %d pure literals, %d dominated\n", n_pure, n_dominated);
+  }
+}
+
+//=================================================================================================
+// Variable elimination:
+
+// Merges the terms on the same variable in 'ps'/'Cs' ('lo' drops by what a term
+// and its negation add up to for sure) and removes the zero terms. 'index'
+// (Var -> position, or -1) is left as it was found.
+static void mergeTerms(vector<Lit>& ps, vector<Int>& Cs, Int& lo, vector<int>& index) {
+  int n = 0;
+  for (int j = 0; j < ps.size(); j++) {
+    int k = index[var(ps[j])];
+    if (k < 0)
+      index[var(ps[j])] = n, ps[n] = ps[j], Cs[n++] = Cs[j];
+    else if (ps[k] == ps[j])
+      Cs[k] += Cs[j];
+    else {
+      Int m = std::min(Cs[k], Cs[j]);
+      lo -= m;
+      if (Cs[k] == m) ps[k] = ps[j], Cs[k] = Cs[j];
+      Cs[k] -= m;
+    }
+  }
+  int m = 0;
+  for (int j = 0; j < n; j++) {
+    index[var(ps[j])] = -1;
+    if (Cs[j] != 0) ps[m] = ps[j], Cs[m++] = Cs[j];
+  }
+  ps.resize(m), Cs.resize(m);
+}
+
+// Eliminates variables by resolution, as for clauses. Adding two constraints
+// (scaled so that 'x' cancels) gives an implied constraint, but in general
+// the resolvents are weaker than the constraints they replace. They are exact
+// if every constraint of one polarity 'p' of 'x' is a clause 'p | A_i': then
+// the constraints 'd_j*~p + R_j >= b_j' of the other polarity are replaced by
+//
+//   R_j >= b_j - d_j        (for each j)
+//   b_j*A_i + R_j >= b_j    (for each i and j, i.e. 'A_i | R_j >= b_j')
+//
+// A variable is only eliminated if this gives no more constraints and no more
+// terms than before. Variables of the goal function or of two-sided constraints
+// are kept. The removed constraints are saved in 'elim' for 'extendModel()'.
+void PbSolver::eliminateVars() {
+  const int max_occurs = 16;  // (per variable)
+  if (nVars() == 0 || !okay()) return;
+  if (occur_start.size() == 0) setupOccurs();
+
+  vector<char> frozen(nVars(), 0);
+  if (goal != NULL)
+    for (int j = 0; j < goal->size; j++) frozen[var((*goal)[j])] = 1;
+  vector<Pair<int, Var> > order;
+  for (Var x = 0; x < nVars(); x++) {
+    int n = n_occurs[toInt(mkLit(x))] + n_occurs[toInt(~mkLit(x))];
+    if (!frozen[x] && value(x) == l_Undef && !eliminated(x) && n <= max_occurs)
+      order.push_back(Pair_new(n, x));
+  }
+  if (order.size() > 0) sort(order);
+  elim_vars.resize(nVars(), 0);
+
+  int n_elim = 0, n_removed = 0, n_added = 0, units = trail.size();
+  int64 work = 0, work_limit = 10 * (int64)occur.size() + 1000000;
+  vector<int> pos, neg, index(nVars(), -1);
+  vector<Lit> ps, res_ps;
+  vector<Int> Cs, res_Cs, res_lo;
+  vector<int> res_start;
+  for (int k = 0; k < order.size() && okay() && work < work_limit; k++) {
+    Var x = order[k].snd;
+    if (value(x) != l_Undef) continue;
+    if (occur_start.size() == 0) setupOccurs();
+
+    // Live constraints of each polarity (and whether they are all clauses):
+    bool ok = true, pos_clauses = true, neg_clauses = true;
+    int n_terms = 0;
+    pos.clear(), neg.clear();
+    for (int pol = 0; pol < 2 && ok; pol++) {
+      int p = toInt(mkLit(x, pol));
+      for (int o = occur_start[p]; o < occur_end[p] && ok; o++) {
+        int i = occur[o];
+        if (constrs[i] == LRef_Undef) continue;
+        const Linear& c = constr_mem[constrs[i]];
+        work += c.size;
+        bool has_p = false, clause = true;
+        for (int j = 0; j < c.size; j++) has_p |= c[j] == toLit(p), clause &= c(j) >= c.lo;
+        if (!has_p) continue;  // (stale occurrence)
+        if (c.hi != Int_MAX) ok = false;
+        (pol ? neg : pos).push_back(i);
+        (pol ? neg_clauses : pos_clauses) &= clause;
+        n_terms += c.size;
+      }
+    }
+    if (!ok || pos.size() == 0 || neg.size() == 0 || pos.size() + neg.size() > max_occurs ||
+        !(pos_clauses || neg_clauses))
+      continue;
+    Lit p = pos_clauses ? mkLit(x) : ~mkLit(x);  // (all constraints of 'p' are clauses)
+    vector<int>& clauses = pos_clauses ? pos : neg;
+    vector<int>& others = pos_clauses ? neg : pos;
+
+    // Resolvents (given up as soon as they get too many or too large):
+    res_ps.clear(), res_Cs.clear(), res_lo.clear(), res_start.clear();
+    int n_res = 0, max_res = pos.size() + neg.size(), res_terms = 0;
+    for (int j = 0; j < others.size() && ok; j++) {
+      for (int i = -1; i < (int)clauses.size() && ok; i++) {
+        const Linear& d = constr_mem[constrs[others[j]]];
+        ps.clear(), Cs.clear();
+        Int d_p = 0;
+        for (int t = 0; t < d.size; t++)
+          if (d[t] == ~p) d_p = d(t);
+          else ps.push_back(d[t]), Cs.push_back(d(t));
+        Int lo = d.lo - d_p;  // ('R_j >= b_j - d_j')
+        if (i >= 0) {         // ('b_j*A_i + R_j >= b_j')
+          const Linear& c = constr_mem[constrs[clauses[i]]];
+          for (int t = 0; t < c.size; t++)
+            if (c[t] != p) ps.push_back(c[t]), Cs.push_back(d.lo);
+          lo = d.lo;
+        }
+        work += ps.size();
+        mergeTerms(ps, Cs, lo, index);
+        if (lo <= 0) continue;  // (trivially satisfied)
+        n_res++, res_terms += ps.size();
+        if (n_res > max_res || res_terms > n_terms) {
+          ok = false;
+          break;
+        }
+        res_start.push_back(res_ps.size());
+        res_lo.push_back(lo);
+        for (int t = 0; t < ps.size(); t++) res_ps.push_back(ps[t]), res_Cs.push_back(Cs[t]);
+      }
+    }
+    if (!ok) continue;
+
+    // Replace the constraints of 'x' by the resolvents:
+    for (int pol = 0; pol < 2; pol++) {
+      vector<int>& is = pol ? neg : pos;
+      for (int j = 0; j < is.size(); j++) {
+        const Linear& c = constr_mem[constrs[is[j]]];
+        ps.clear(), Cs.clear();
+        for (int t = 0; t < c.size; t++) ps.push_back(c[t]), Cs.push_back(c(t));
+        elim.push_back(Pair_new(x, elim_mem.alloc(ps, Cs, c.lo, c.hi)));
+        constrs[is[j]] = LRef_Undef;
+      }
+    }
+    res_start.push_back(res_ps.size());
+    for (int r = 0; r + 1 < res_start.size() && okay(); r++) {
+      ps.assign(res_ps.begin() + res_start[r], res_ps.begin() + res_start[r + 1]);
+      Cs.assign(res_Cs.begin() + res_start[r], res_Cs.begin() + res_start[r + 1]);
+      Int lo = res_lo[r];
+      if (normalizePb(ps, Cs, lo)) storePb(ps, Cs, lo, Int_MAX);
+    }
+    elim_vars[x] = 1;
+    n_elim++, n_removed += pos.size() + neg.size(), n_added += n_res;
+  }
+
+  if (okay() && trail.size() > units) propagateAll(false);
+
+  if (opt_verbosity >= 1) {
+    if (n_elim == 0)
+      reportf("  -- Variable elimination: (none)\n");
+    else
+      reportf("  -- Variable elimination: %d variables, %d constraints replaced by %d\n", n_elim,
+              n_removed, n_added);
+  }
+}
+
+// Sets the values of the variables removed by preprocessing in a model of the
+// remaining problem, in the reverse order of their removal: first eliminated
+// variables (a value satisfying all their saved constraints), then substituted
+// ones.
+void PbSolver::extendModel(Minisat::vec<lbool>& model) {
+  for (int k = (int)elim.size() - 1; k >= 0;) {
+    Var x = elim[k].fst;
+    model[x] = l_False;
+    bool sat = true;
+    for (; k >= 0 && elim[k].fst == x; k--) {
+      const Linear& c = elim_mem[elim[k].snd];
+      Int sum = 0;
+      for (int j = 0; j < c.size; j++)
+        if ((model[var(c[j])] ^ sign(c[j])) == l_True) sum += c(j);
+      if (sum < c.lo || sum > c.hi) sat = false;
+    }
+    if (!sat) model[x] = l_True;
+  }
+  for (Var x = 0; x < subst.size(); x++)
+    if (subst[x] != lit_Undef) model[x] = model[var(subst[x])] ^ sign(subst[x]);
+}
+
 //=================================================================================================
 // Main solver/optimizer:
 
@@ -548,14 +1502,27 @@ static Int evalGoal(Linear& goal, Minisat::vec<lbool>& model) {
 }
 
 void PbSolver::solve(solve_Command cmd) {
-  if (!okay()) return;
+  if (!okay()) {
+    if (opt_save_snapshot != NULL) saveSnapshot(opt_save_snapshot);
+    return;
+  }
 
   // Convert constraints:
   pb_n_vars = nVars();
   pb_n_constrs = constrs.size();
   if (opt_verbosity >= 1)
     reportf("Converting %d PB-constraints to clauses...\n", constrs.size());
-  propagate();
+  if (opt_load_snapshot == NULL) {  // (a snapshot is saved after these)
+    propagate();
+    if (opt_probe_time > 0) probe();
+  }
+  if (opt_save_snapshot != NULL) saveSnapshot(opt_save_snapshot);
+  substituteEquivalences();
+  strengthenConstraints();
+  if (cmd != sc_AllSolutions) {  // (these may lose solutions)
+    fixDominated();
+    eliminateVars();
+  }
   if (!convertPbs(true)) {
     assert(!okay());
     return;
@@ -603,13 +1570,14 @@ void PbSolver::solve(solve_Command cmd) {
   int n_solutions = 0;  // (only for AllSolutions mode)
   while (sat_solver.solve()) {
     sat = true;
+    extendModel(sat_solver.model);
     if (cmd == sc_AllSolutions) {
       Minisat::vec<Lit> ban;
       n_solutions++;
       reportf("MODEL# %d:", n_solutions);
       for (Var x = 0; x < pb_n_vars; x++) {
         assert(sat_solver.model[x] != l_Undef);
-        ban.push(mkLit(x, sat_solver.model[x] == l_True));
+        if (!eliminated(x)) ban.push(mkLit(x, sat_solver.model[x] == l_True));
         reportf(" %s%s", (sat_solver.model[x] == l_False) ? "-" : "",
                 index2name[x]);
       }
@@ -661,8 +1629,7 @@ void PbSolver::solve(solve_Command cmd) {
 }
 
 PbSolver::~PbSolver() {
-  // mem.freeAll();
-  // xfree(goal);
+  if (goal != NULL) Linear_delete(goal);
 }
 
 void PbSolver::printStats() {
@@ -35,13 +35,16 @@ SOFTWARE.
 
 #include "Map.h"
 #include "StackAlloc.h"
+#include "StringArena.h"
 #include<vector>
+#include <limits>
 
 using Minisat::Var;
 using Minisat::Lit;
 using Minisat::SimpSolver;
 using Minisat::lbool;
 using Minisat::mkLit;
+using Minisat::toLit;
 using Minisat::lit_Undef;
 using Minisat::l_Undef;
 using Minisat::l_True;
@@ -49,35 +52,160 @@ using Minisat::l_False;
 using Minisat::var_Undef;
 using std::vector;
 
+#define PbSolver_MinNumLimit (1 << 20)
+#define PbSolver_MaxNumLimit (1 << 28)
+
 //=================================================================================================
 // Linear -- a class for storing pseudo-boolean constraints:
 
+// The terms are stored right after the object: first all literals, then all
+// coefficients, each in the smallest of 1, 2 or 4 bytes that fits every
+// coefficient of the constraint (or as 'Int' if none does).
 class Linear {
   int orig_size;  // Allocated terms in constraint.
+  int width;      // Bytes per stored coefficient (0 = stored as 'Int').
  public:
   int size;    // Terms in constraint.
   Int lo, hi;  // Sum should be in interval [lo,hi] (inclusive).
+
  private:
-  vector<Lit> ps;
-  vector<Int>  cs;
+  Linear(const Linear&);  // (not copyable)
+  char* data() { return (char*)(this + 1); }
+  const char* data() const { return (const char*)(this + 1); }
+  static size_t coefsOffset(int n) {  // (keeps 'Int' coefficients aligned)
+    return (n * sizeof(Lit) + sizeof(Int) - 1) / sizeof(Int) * sizeof(Int);
+  }
+  template <class T>
+  static bool fits(Int c) {
+    return c >= Int(std::numeric_limits<T>::min()) &&
+           c <= Int(std::numeric_limits<T>::max());
+  }
+
  public:
-  // NOTE: Cannot be used by normal 'new' operator!
-  Linear(const vector<Lit>& Ps, const vector<Int>& Cs, Int low, Int high) {
-    
-    ps.insert(ps.begin(), Ps.begin(), Ps.end());
-    cs.insert(cs.begin(), Cs.begin(), Cs.end());
-    size= cs.size(); lo = low; hi = high;
+  static int widthOf(const vector<Int>& Cs) {
+    int w = 1;
+    for (size_t i = 0; i < Cs.size(); i++) {
+      if (w == 1 && !fits<int8_t>(Cs[i])) w = 2;
+      if (w == 2 && !fits<int16_t>(Cs[i])) w = 4;
+      if (w == 4 && !fits<int32_t>(Cs[i])) return 0;
+    }
+    return w;
+  }
+  static size_t bytes(int n, int width) {
+    return sizeof(Linear) + coefsOffset(n) + n * (width == 0 ? sizeof(Int) : width);
+  }
+  size_t bytes() const { return bytes(orig_size, width); }
+
+  // NOTE: Cannot be used by normal 'new' operator! Construct with placement
+  // 'new' in 'bytes(Ps.size(), widthOf(Cs))' bytes of memory.
+  Linear(const vector<Lit>& Ps, const vector<Int>& Cs, Int low, Int high)
+      : orig_size(Ps.size()), width(widthOf(Cs)), size(Ps.size()), lo(low), hi(high) {
+    for (int i = 0; i < size; i++) (*this)[i] = Ps[i];
+    if (width == 0)
+      for (int i = 0; i < size; i++)
+        new (data() + coefsOffset(orig_size) + i * sizeof(Int)) Int(Cs[i]);
+    else
+      for (int i = 0; i < size; i++) setCoef(i, Cs[i]);
+  }
+  ~Linear() {
+    if (width == 0)
+      for (int i = 0; i < orig_size; i++)
+        ((Int*)(data() + coefsOffset(orig_size)))[i].~Int();
   }
-  Lit operator[](int i) const { return ps[i];}
+
+  Lit operator[](int i) const { return ((const Lit*)data())[i]; }
+  Lit& operator[](int i) { return ((Lit*)data())[i]; }
   Int operator()(int i) const {
-    return cs[i];
+    const char* cs = data() + coefsOffset(orig_size);
+    switch (width) {
+      case 1: return Int(((const int8_t*)cs)[i]);
+      case 2: return Int(((const int16_t*)cs)[i]);
+      case 4: return Int(((const int32_t*)cs)[i]);
+      default: return ((const Int*)cs)[i];
+    }
   }
-  Lit& operator[](int i) { return ps[i]; }
-  Int& operator()(int i) {
-    return cs[i];
+  void setCoef(int i, Int c) {  // ('c' must fit the width of the constraint)
+    char* cs = data() + coefsOffset(orig_size);
+    switch (width) {
+      case 1: ((int8_t*)cs)[i] = (int8_t)(int64)c; break;
+      case 2: ((int16_t*)cs)[i] = (int16_t)(int64)c; break;
+      case 4: ((int32_t*)cs)[i] = (int32_t)(int64)c; break;
+      default: ((Int*)cs)[i] = c;
+    }
   }
 };
 
+// For single constraints outside 'LinearAlloc' (such as the goal function):
+macro Linear* Linear_new(const vector<Lit>& ps, const vector<Int>& Cs, Int lo, Int hi) {
+  char* mem = new char[Linear::bytes(ps.size(), Linear::widthOf(Cs))];
+  return new (mem) Linear(ps, Cs, lo, hi);
+}
+macro void Linear_delete(Linear* c) {
+  c->~Linear();
+  delete[] (char*)c;
+}
+
+//=================================================================================================
+// LinearAlloc -- one contiguous region holding many 'Linear's, referred to by
+// offsets ('LRef'). The region may move when it grows, so don't keep a 'Linear&'
+// across an 'alloc()'.
+
+typedef uint LRef;  // (in 8 byte units)
+#define LRef_Undef (~(LRef)0)
+
+class LinearAlloc {
+  uint64* memory;
+  uint sz, cap;
+
+ public:
+  LinearAlloc(void) : memory(NULL), sz(0), cap(0) {}
+  ~LinearAlloc(void) { clear(); }
+
+  LRef alloc(const vector<Lit>& ps, const vector<Int>& Cs, Int lo, Int hi) {
+    uint64 n = (Linear::bytes(ps.size(), Linear::widthOf(Cs)) + 7) / 8;
+    if (sz + n > cap) {
+      uint64 new_cap = max((uint64)cap + (cap >> 1) + 1024, sz + n);
+      if (new_cap >= LRef_Undef)
+        fprintf(stderr, "ERROR! Out of memory for constraints.\n"), exit(1);
+      memory = (uint64*)realloc(memory, new_cap * sizeof(uint64));
+      if (memory == NULL)
+        fprintf(stderr, "ERROR! Out of memory for constraints.\n"), exit(1);
+      cap = new_cap;
+    }
+    LRef r = sz;
+    sz += n;
+    new (&memory[r]) Linear(ps, Cs, lo, hi);
+    return r;
+  }
+
+  Linear& operator[](LRef r) { return *(Linear*)&memory[r]; }
+  const Linear& operator[](LRef r) const { return *(const Linear*)&memory[r]; }
+
+  uint64 bytes(void) const { return (uint64)sz * sizeof(uint64); }
+  void clear(void) {  // (frees all constraints at once)
+    for (uint r = 0; r < sz;) {
+      Linear& c = (*this)[r];
+      r += (c.bytes() + 7) / 8;
+      c.~Linear();
+    }
+    free(memory);
+    memory = NULL;
+    sz = cap = 0;
+  }
+};
+
+//=================================================================================================
+// Slack -- per-constraint counters of the incremental unit propagation:
+
+struct Slack {
+  Int lo;        // Sum of the coefficients not yet false, minus 'Linear::lo'.
+  Int hi;        // 'Linear::hi' minus the sum of the coefficients already true.
+  Int max_coef;  // Coefficient at 'top' (at least the largest undecided one).
+  int top;       // Index of the largest coefficient that may still be undecided.
+  bool has_lo, has_hi;  // Is there a lower/upper bound at all?
+  bool touched;         // Has any literal been assigned (constraint needs compacting)?
+};
+
 //=================================================================================================
 // PbSolver -- Pseudo-boolean solver (linear boolean constraints):
 
@@ -86,27 +214,73 @@ class PbSolver {
   SimpSolver sat_solver;  // Underlying SAT solver.
   vector<Lit> trail;         // Chronological assignment stack.
 
-  // StackAlloc<char*> mem;  // Used to allocate the 'Linear' constraints stored in
+  LinearAlloc constr_mem;  // Used to allocate the 'Linear' constraints stored in
                           // 'constrs' (other 'Linear's, such as the goal
-                          // function, are allocated with 'xmalloc()')
+                          // function, are allocated with 'Linear_new()')
 
  public:
-  vector<Linear*> constrs;  // Vector with all constraints.
+  vector<LRef> constrs;  // Vector with all constraints ('LRef_Undef' = removed).
   Linear* goal;  // Non-normalized goal function (used in optimization). NULL
                  // means no goal function specified. NOTE! We are always
                  // minimizing.
  protected:
   vector<int> n_occurs;     // Lit -> int: Number of occurrences.
-  vector<vector<int> > occur;  // Lit -> vec<int>: Occur lists. Left empty until
-                         // 'setupOccurs()' is called.
+  vector<int> occur_start;  // Lit -> int: First slot of the occur list of 'Lit' in 'occur'.
+  vector<int> occur_end;    // Lit -> int: One past the last used slot of that list.
+  vector<int> occur;  // All occur lists (constraint indices) back to back, each with
+                      // 'n_occurs' slots. Left empty until 'setupOccurs()' is called.
+  vector<Int> occur_coef;  // Coefficient of the literal in the constraint of the same slot.
+  vector<Slack> slack;  // Constraint index -> counters (only valid inside 'propagate()'
+                        // and 'probe()').
+
+  // Tentative assignments of 'probe()':
+  bool probing;                 // Assignments in 'propagateSlack()' are tentative.
+  vector<lbool> probe_assigns;  // Var -> tentative value.
+  vector<Lit> probe_trail;      // Tentative assignments in chronological order.
+  vector<char> probe_indirect;  // Was it implied by propagating other than the probe itself?
+  int probe_head;               // Propagated part of 'probe_trail'.
+  vector<Pair<int, int> > probe_tops;  // Undo log of 'Slack::top' (constraint, old value).
+
+  vector<Lit> subst;  // Var -> literal it was replaced by ('lit_Undef' if none). Set by
+                      // 'substituteEquivalences()', used by 'extendModel()'.
+  vector<char> elim_vars;  // Var -> removed by 'eliminateVars()'?
+  vector<Pair<Var, LRef> > elim;  // Eliminated variables (in order) with each of the
+                                  // constraints they were in, kept for 'extendModel()'.
+  LinearAlloc elim_mem;           // Storage of those constraints (outlives 'constr_mem').
+
+  double sweep_time_left;  // Seconds of 'sweep()' left for the remaining calls of 'convertPbs()'.
 
   int propQ_head;  // Head of propagation queue (index into 'trail').
   Minisat::vec<Lit> tmp_clause;
 
+  // Scratch space of 'addConstr()' and 'normalizePb()' (reused between calls to
+  // avoid allocation):
+  vector<Lit> norm_ps;
+  vector<Int> norm_Cs;
+  vector<unsigned> norm_stamp;  // Var -> epoch in which 'norm_index' was set.
+  vector<int> norm_index;       // Var -> index into 'norm_consts'.
+  unsigned norm_epoch;
+  vector<Pair<Var, Pair<Int, Int> > > norm_consts;  // Variable -> negative/positive polarity constant
+  vector<Pair<Int, Lit> > norm_Csps;
+
   // Main internal methods:
   //
   bool propagate(Linear& c);
   void propagate();
+  bool propagateAll(bool report);
+  void initSlack(int i);
+  bool updateSlack(Lit p);
+  void revertSlack(Lit p);
+  bool propagateSlack(int i);
+  bool propagateUnits();
+  bool probeLit(Lit p);
+  void undoProbe();
+  void probe();
+  void implicationGraph(vector<int>& start, vector<int>& edges);
+  void substituteEquivalences();
+  void strengthenConstraints();
+  void fixDominated();
+  void eliminateVars();
   bool addUnit(Lit p) {
     if (value(p) == l_Undef) trail.push_back(p);
     return sat_solver.addClause(p);
@@ -120,6 +294,8 @@ class PbSolver {
   bool normalizePb(vector<Lit>& ps, vector<Int>& Cs, Int& C);
   void storePb(const vector<Lit>& ps, const vector<Int>& Cs, Int lo, Int hi);
   void setupOccurs();  // Called on demand from 'propagate()'.
+  void addOccurs(int i);  // Called from 'storePb()' while occur lists exist.
+  void emptyOccurs();     // Called when 'constrs' is cleared (keeps the slots).
   void findIntervals();
   bool rewriteAlmostClauses();
   bool convertPbs(bool first_call);  // Called from 'solve()' to convert PB
@@ -128,11 +304,16 @@ class PbSolver {
  public:
   PbSolver(bool use_preprocessing = false)
       : goal(NULL),
-        propQ_head(0)
+        probing(false),
+        probe_head(0),
+        sweep_time_left(0),
+        propQ_head(0),
+        norm_epoch(0)
         //, stats(sat_solver.stats_ref())
         ,
         declared_n_vars(-1),
         declared_n_constrs(-1),
+        num_limit(PbSolver_MinNumLimit),
         best_goalvalue(Int_MAX) {
     // Turn off preprocessing if wanted.
     if (!use_preprocessing) sat_solver.eliminate(true);
@@ -143,12 +324,22 @@ class PbSolver {
   //
   lbool value(Var x) const { return sat_solver.value(x); }
   lbool value(Lit p) const { return sat_solver.value(p); }
+  lbool pbValue(Lit p) const {  // (includes tentative assignments while probing)
+    if (probing && probe_assigns[var(p)] != l_Undef)
+      return probe_assigns[var(p)] ^ sign(p);
+    return value(p);
+  }
+  bool eliminated(Var x) const {  // (removed by preprocessing, see 'extendModel()')
+    return (x < (int)subst.size() && subst[x] != lit_Undef) ||
+           (x < (int)elim_vars.size() && elim_vars[x]);
+  }
   int nVars() const { return sat_solver.nVars(); }
   int nConstrs() const { return constrs.size(); }
 
   // Public variables:
   // BasicSolverStats& stats;
   void printStats();
+  void extendModel(Minisat::vec<lbool>& model);
 
   int declared_n_vars;  // Number of variables declared in file header (-1 = not
                         // specified).
@@ -157,7 +348,10 @@ class PbSolver {
   int pb_n_vars;     // Actual number of variables (before clausification).
   int pb_n_constrs;  // Actual number of constraints (before clausification).
 
-  Map<cchar*, int> name2index;
+  Map<cchar*, int> name2index;  // Names not covered by 'num2index'.
+  vector<int> num2index;  // 'x<N>' -> variable index (-1 = not yet created).
+  int num_limit;          // Only 'x<N>' with 'N < num_limit' go in 'num2index'.
+  StringArena name_mem;   // Storage for the strings of 'index2name'.
   vector<cchar*> index2name;
   vector<bool> best_model;  // Best model found (size is 'pb_n_vars').
   Int best_goalvalue;  // Value of goal function for that model (or 'Int_MAX' if
@@ -170,6 +364,12 @@ class PbSolver {
   void addGoal(const vector<Lit>& ps, const vector<Int>& Cs);
   bool addConstr(const vector<Lit>& ps, const vector<Int>& Cs, Int rhs, int ineq);
 
+  // Snapshots of the normalized problem (see 'PbSolver_snapshot.cc'):
+  //
+  void saveSnapshot(cchar* filename);
+  bool loadSnapshot(cchar* filename);  // (into an empty solver; FALSE if the
+                                       // file is missing or invalid)
+
   // Solve:
   //
   bool okay(void) { return sat_solver.okay(); }
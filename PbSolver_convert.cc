@@ -27,20 +27,37 @@ Formula convertToBdd   (const Linear& c, int max_cost = INT_MAX);   // From: PbS
 //-------------------------------------------------------------------------------------------------
 
 
+// Every number the encoders compute for 'c' is bounded by the sum of its coefficients and
+// the absolute values of its bounds (with room to spare), so pick the narrowest type for that.
+CoefWidth coefWidth(const Linear& c)
+{
+    Int bound = 1;
+    for (int j = 0; j < c.size; j++)
+        bound += c(j);
+    if (c.lo != Int_MIN) bound += c.lo < 0 ? -c.lo : c.lo;
+    if (c.hi != Int_MAX) bound += c.hi < 0 ? -c.hi : c.hi;
+    return bound <= Int(INT_MAX / 4)   ? cw_Int
+         : bound <= Int(LLONG_MAX / 4) ? cw_Int64
+         :                               cw_Big;
+}
+
+
 bool PbSolver::convertPbs(bool first_call)
 {
     vector<Formula>    converted_constrs;
 
     if (first_call){
+        sweep_time_left = opt_sweep_time;
         findIntervals();
+        if (!okay()) return false;
         if (!rewriteAlmostClauses()){
             sat_solver.addEmptyClause();
             return false; }
     }
 
     for (size_t i = 0; i < constrs.size(); i++){
-        if (constrs[i] == NULL) continue;
-        Linear& c   = *constrs[i]; assert(c.lo != Int_MIN || c.hi != Int_MAX);
+        if (constrs[i] == LRef_Undef) continue;
+        Linear& c   = constr_mem[constrs[i]]; assert(c.lo != Int_MIN || c.hi != Int_MAX);
 
         if (opt_verbosity >= 1)
             /**/reportf("---[%4d]---> ", constrs.size() - 1 - i);
@@ -67,16 +84,22 @@ bool PbSolver::convertPbs(bool first_call)
         if (!okay()) return false;
     }
 
-    // NOTE: probably still leaks memory (if there are constraints that are NULL'ed elsewhere)
-    for (size_t i = 0; i < constrs.size(); i++){
-      if (constrs[i] != NULL){
-        delete constrs[i];
-      }
-    }
+    if (opt_verbosity >= 1 && FEnv::uniqueness_table.lookups() > 0)
+        reportf("  -- Structural hashing: %d entries (peak %d), load %.0f%%, %.2f groups/lookup (longest %d)\n",
+            FEnv::uniqueness_table.size(), FEnv::uniqueness_table.maxSize(),
+            FEnv::uniqueness_table.loadFactor() * 100, FEnv::uniqueness_table.avgProbe(),
+            FEnv::uniqueness_table.maxProbe());
 
     constrs.clear();
+    constr_mem.clear();
+    emptyOccurs();
+
+    if (!sweep(converted_constrs, sweep_time_left)){
+        sat_solver.addEmptyClause();
+        return false; }
 
     clausify(sat_solver, converted_constrs);
+    compactClausify();
 
     return okay();
 }
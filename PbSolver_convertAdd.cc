@@ -23,7 +23,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 // Write 'd' in binary, then substitute 0 with '_0_', 1 with 'f'. This is the resulting 'out' vector.
 //
-static inline void bitAdder(Int d, Formula f, vector<Formula>& out)
+template<class T>
+static inline void bitAdder(T d, Formula f, vector<Formula>& out)
 {
   out.clear();
   for (; d != 0; d >>= 1)
@@ -52,29 +53,32 @@ static void lte(vector<Formula>& xs, vector<Formula>& ys, vector<Formula>& out)
 
 
 
-void linearAddition(const Linear& l, vector<Formula>& out)
+template<class T>
+static void linearAddition(const Linear& l, vector<Formula>& out)
 {
   vector<Formula> sum;
   vector<Formula> inp;
-  vector<Int>     cs;
+  vector<T>       cs;
 
   for (int i = 0; i < l.size; i++){
     inp.push_back(id(var(var(l[i])),sign(l[i])));
-    cs.push_back(l(i));
+    cs.push_back(Coef<T>::from(l(i)));
   }
 
-  Int     maxlim = (l.hi != Int_MAX) ? l.hi : (l.lo - 1);
+  T       lo     = Coef<T>::from(l.lo);
+  T       hi     = Coef<T>::from(l.hi);
+  T       maxlim = (l.hi != Int_MAX) ? hi : (lo - 1);
   int     bits   = 0;
-  for (Int i = maxlim; i != 0; i >>= 1)
+  for (T i = maxlim; i != 0; i >>= 1)
     bits++;
 
-  int     nodes = FEnv::nodes.size();
+  int     nodes = FEnv::size();
 
   addPb(inp,cs,sum,bits);
   if (opt_verbosity >= 1){
-    char* tmp = toString(maxlim);    
+    char* tmp = Int(maxlim).toString();
 
-    reportf("Adder-cost: %d   maxlim: %s   bits: %d/%d\n", FEnv::nodes.size() - nodes, tmp, sum.size(), bits);
+    reportf("Adder-cost: %d   maxlim: %s   bits: %d/%d\n", FEnv::size() - nodes, tmp, sum.size(), bits);
     delete[] tmp;
 
   }
@@ -82,17 +86,27 @@ void linearAddition(const Linear& l, vector<Formula>& out)
 
   if (l.lo != Int_MIN){
     //reportf("lower limit\n");
-    bitAdder(l.lo,_1_,inp);
+    bitAdder(lo,_1_,inp);
     lte(inp,sum,out);
   }
   if (l.hi != Int_MAX){
     //reportf("upper limit\n");
-    bitAdder(l.hi,_1_,inp);
+    bitAdder(hi,_1_,inp);
     lte(sum,inp,out);
   }
 }
 
 
+void linearAddition(const Linear& l, vector<Formula>& out)
+{
+  switch (coefWidth(l)){
+  case cw_Int:   linearAddition<int>  (l, out); break;
+  case cw_Int64: linearAddition<int64>(l, out); break;
+  default:       linearAddition<Int>  (l, out);
+  }
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // (old)
 
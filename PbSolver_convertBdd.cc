@@ -18,6 +18,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 **************************************************************************************************/
 
 #include "PbSolver.h"
+#include "Hardware.h"
 #include "FEnv.h"
 #include "Debug.h"
 
@@ -25,12 +26,13 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 //=================================================================================================
 
 
+template<class T>
 static
 //Formula buildBDD(const Linear& c, int size, int lower_limit, int upper_limit, int material_left, Map<Pair<int,Int>,Formula>& memo, int max_cost)
-Formula buildBDD(const Linear& c, int size, Int sum, Int material_left, Map<Pair<int,Int>,Formula>& memo, int max_cost)
+Formula buildBDD(const Linear& c, const vector<T>& Cs, T lo, T hi, int size, T sum, T material_left, Map<Pair<int,T>,Formula>& memo, int max_cost)
 {
-    Int lower_limit = (c.lo == Int_MIN) ? Int_MIN : c.lo - sum;
-    Int upper_limit = (c.hi == Int_MAX) ? Int_MAX : c.hi - sum;
+    T lower_limit = (lo == Coef<T>::min()) ? Coef<T>::min() : lo - sum;
+    T upper_limit = (hi == Coef<T>::max()) ? Coef<T>::max() : hi - sum;
 
     if (lower_limit <= 0 && upper_limit >= material_left)
         return _1_;
@@ -39,38 +41,39 @@ Formula buildBDD(const Linear& c, int size, Int sum, Int material_left, Map<Pair
     else if (FEnv::topSize() > max_cost)
         return _undef_;     // (mycket elegant!)
 
-    Pair<int,Int>   key = Pair_new(size, lower_limit);
+    Pair<int,T>     key = Pair_new(size, lower_limit);
     Formula         ret;
 
     if (!memo.peek(key, ret)){
         assert(size != 0);
         size--;
-        material_left -= c(size);
-        Int hi_sum = sign(c[size]) ? sum : sum + c(size);
-        Int lo_sum = sign(c[size]) ? sum + c(size) : sum;
-        Formula hi = buildBDD(c, size, hi_sum, material_left, memo, max_cost);
-        if (hi == _undef_) return _undef_;
-        Formula lo = buildBDD(c, size, lo_sum, material_left, memo, max_cost);
-        if (lo == _undef_) return _undef_;
-        ret = ITE(var(var(c[size])), hi, lo);
+        material_left -= Cs[size];
+        T hi_sum = sign(c[size]) ? sum : sum + Cs[size];
+        T lo_sum = sign(c[size]) ? sum + Cs[size] : sum;
+        Formula hi_ = buildBDD(c, Cs, lo, hi, size, hi_sum, material_left, memo, max_cost);
+        if (hi_ == _undef_) return _undef_;
+        Formula lo_ = buildBDD(c, Cs, lo, hi, size, lo_sum, material_left, memo, max_cost);
+        if (lo_ == _undef_) return _undef_;
+        ret = ITE(var(var(c[size])), hi_, lo_);
         memo.set(key, ret);
     }
     return ret;
 }
 
 
-// New school: Use the new 'ITE' construction of the formula environment 'FEnv'.
-//
-Formula convertToBdd(const Linear& c, int max_cost)
+template<class T>
+static Formula convertToBdd(const Linear& c, int max_cost)
 {
-    Map<Pair<int,Int>, Formula> memo;
+    Map<Pair<int,T>, Formula> memo;
+    vector<T> Cs;
 
-    Int sum = 0;
+    T sum = 0;
     for (int j = 0; j < c.size; j++)
-        sum += c(j);
+        Cs.push_back(Coef<T>::from(c(j))),
+        sum += Cs[j];
 
     FEnv::push();
-    Formula ret = buildBDD(c, c.size, 0, sum, memo, max_cost);
+    Formula ret = buildBDD(c, Cs, Coef<T>::from(c.lo), Coef<T>::from(c.hi), c.size, T(0), sum, memo, max_cost);
     if (ret == _undef_)
         FEnv::pop();
     else{
@@ -80,3 +83,15 @@ Formula convertToBdd(const Linear& c, int max_cost)
     }
     return ret;
 }
+
+
+// New school: Use the new 'ITE' construction of the formula environment 'FEnv'.
+//
+Formula convertToBdd(const Linear& c, int max_cost)
+{
+    switch (coefWidth(c)){
+    case cw_Int:   return convertToBdd<int>  (c, max_cost);
+    case cw_Int64: return convertToBdd<int64>(c, max_cost);
+    default:       return convertToBdd<Int>  (c, max_cost);
+    }
+}
@@ -39,11 +39,15 @@ int primes[] = { 2, 3, 5, 7, 11, 13, 17 };
 //int primes[] = { 2, 3, 4, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311, 313, 317, 331, 337, 347, 349, 353, 359, 367, 373, 379, 383, 389, 397, 401, 409, 419, 421, 431, 433, 439, 443, 449, 457, 461, 463, 467, 479, 487, 491, 499, 503, 509, 521, 523, 541, 547, 557, 563, 569, 571, 577, 587, 593, 599, 601, 607, 613, 617, 619, 631, 641, 643, 647, 653, 659, 661, 673, 677, 683, 691, 701, 709, 719, 727, 733, 739, 743, 751, 757, 761, 769, 773, 787, 797, 809, 811, 821, 823, 827, 829, 839, 853, 857, 859, 863, 877, 881, 883, 887, 907, 911, 919, 929, 937, 941, 947, 953, 967, 971, 977, 983, 991, 997 };
 
 
+template<class T>
 static
-void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, vector<int>& base, int& cost_bestfound, vector<int>& base_bestfound)
+void optimizeBase(vector<T>& seq, int carry_ins, vector<T>& rhs, int cost, vector<int>& base, int& cost_bestfound, vector<int>& base_bestfound, int& nodes_left)
 {
     if (cost >= cost_bestfound)
         return;
+    if (nodes_left <= 0 && cost_bestfound != INT_MAX)
+        return;     // (wide coefficients can make the tree of bases huge; settle for the best so far)
+    nodes_left--;
 
     // "Base case" -- don't split further, build sorting network for current sequence:
     int final_cost = 0;
@@ -51,7 +55,7 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
         if (seq[i] > INT_MAX)
             goto TooBig;
       #ifdef ExpensiveBigConstants
-        final_cost += seq[i];
+        final_cost += (int)seq[i];
       #else
         int c; for (c = 1; c*c < seq[i]; c++);
         final_cost += c;
@@ -59,7 +63,7 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
         if (final_cost < 0)
             goto TooBig;
     }
-    if (cost + final_cost < cost_bestfound){
+    if (final_cost < cost_bestfound - cost){     // ('cost + final_cost' may overflow)
       base_bestfound=base;
       // base.swap(base_bestfound);
       cost_bestfound = cost + final_cost;
@@ -70,8 +74,8 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
 
     // <<== could count 1:s here for efficiency
 
-    vector<Int> new_seq;
-    vector<Int> new_rhs;
+    vector<T> new_seq;
+    vector<T> new_rhs;
 #ifdef PickSmallest
     int p = -1;
     for (int i = 0; i < seq.size(); i++)
@@ -84,13 +88,13 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
         int p    = primes[i];
 #endif
         int rest = carry_ins;   // Sum of all the remainders.
-        Int div, rem;
+        T div, rem;
 
         /**/for (int n = depth; n != 0; n--) pf("  "); pf("prime=%d   carry_ins=%d\n", p, carry_ins);
         /**/for (int n = depth; n != 0; n--) pf("  "); pf("New seq:");
         for (size_t j = 0; j < seq.size(); j++){
-            rest += seq[j] % Int(p);
-            div = seq[j] / Int(p);
+            rest += (int)(seq[j] % T(p));
+            div = seq[j] / T(p);
             if (div > 0)
                 //**/pf(" %d", div),
                 new_seq.push_back(div);
@@ -122,7 +126,7 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
 
         base.push_back(p);
         /**/depth++;
-        optimizeBase(new_seq, rest/p, new_rhs, cost+(digit_important ? rest : 0), base, cost_bestfound, base_bestfound);
+        optimizeBase(new_seq, rest/p, new_rhs, cost+(digit_important ? rest : 0), base, cost_bestfound, base_bestfound, nodes_left);
         /**/depth--;
         base.pop_back();
 
@@ -132,13 +136,15 @@ void optimizeBase(vector<Int>& seq, int carry_ins, vector<Int>& rhs, int cost, v
 }
 
 
+template<class T>
 static
-void optimizeBase(vector<Int>& seq, vector<Int>& rhs, int& cost_bestfound, vector<int>& base_bestfound)
+void optimizeBase(vector<T>& seq, vector<T>& rhs, int& cost_bestfound, vector<int>& base_bestfound)
 {
     vector<int>    base;
     cost_bestfound = INT_MAX;
+    int            nodes_left = 1000000;
     base_bestfound.clear();
-    optimizeBase(seq, 0, rhs, 0, base, cost_bestfound, base_bestfound);
+    optimizeBase(seq, 0, rhs, 0, base, cost_bestfound, base_bestfound, nodes_left);
 }
 
 
@@ -157,20 +163,22 @@ void buildSorter(vector<Formula>& ps, vector<int>& Cs, vector<Formula>& out_sort
     oddEvenSort(out_sorter); // (overwrites inputs)
 }
 
-// static
-//     void buildSorter(vector<Formula>& ps, vector<Int>& Cs, vector<Formula>& out_sorter)
-// {
-//     vector<int>    Cs_copy;
-//     for (size_t i = 0; i < Cs.size(); i++)
-//         Cs_copy.push_back(Cs[i]);
-//     buildSorter(ps, Cs_copy, out_sorter);
-// }
+template<class T>
+static
+    void buildSorter(vector<Formula>& ps, vector<T>& Cs, vector<Formula>& out_sorter)
+{
+    vector<int>    Cs_copy;
+    for (size_t i = 0; i < Cs.size(); i++)
+        Cs_copy.push_back((int)Cs[i]);
+    buildSorter(ps, Cs_copy, out_sorter);
+}
 
 
 class Exception_TooBig {};
 
+template<class T>
 static
-void buildConstraint(vector<Formula>& ps, vector<Int>& Cs, vector<Formula>& carry, vector<int>& base, int digit_no, vector<vector<Formula> >& out_digits, int max_cost)
+void buildConstraint(vector<Formula>& ps, vector<T>& Cs, vector<Formula>& carry, vector<int>& base, int digit_no, vector<vector<Formula> >& out_digits, int max_cost)
 {
     assert(ps.size() == Cs.size());
 
@@ -196,13 +204,13 @@ void buildConstraint(vector<Formula>& ps, vector<Int>& Cs, vector<Formula>& carr
         vector<Formula>    ps_rem;
         vector<int>        Cs_rem;
         vector<Formula>    ps_div;
-        vector<Int>        Cs_div;
+        vector<T>          Cs_div;
 
         // Split sum according to base:
         int B = base[digit_no];
         for (int i = 0; i < Cs.size(); i++){
-            Int div = Cs[i] / Int(B);
-            int rem = Cs[i] % Int(B);
+            T div = Cs[i] / T(B);
+            int rem = (int)(Cs[i] % T(B));
             if (div > 0){
                 ps_div.push_back(ps[i]);
                 Cs_div.push_back(div);
@@ -250,14 +258,15 @@ Naming:
 */
 
 
+template<class T>
 static
-void convert(Int num, vector<int>& base, vector<int>& out_digs)
+void convert(T num, vector<int>& base, vector<int>& out_digs)
 {
     for (int i = 0; i < base.size(); i++){
-        out_digs.push_back(num % base[i]);
-        num /= Int(base[i]);
+        out_digs.push_back((int)(num % base[i]));
+        num /= T(base[i]);
     }
-    out_digs.push_back(num);
+    out_digs.push_back((int)num);
 }
 
 
@@ -292,8 +301,9 @@ Formula lexComp(vector<int>& num, vector<vector<Formula> >& digits) {
     return lexComp(num.size(), num, digits); }
 
 
+template<class T>
 static
-Formula buildConstraint(vector<Formula>& ps, vector<Int>& Cs, vector<int>& base, Int lo, Int hi, int max_cost)
+Formula buildConstraint(vector<Formula>& ps, vector<T>& Cs, vector<int>& base, T lo, T hi, int max_cost)
 {
     vector<Formula> carry;
     vector<vector<Formula> > digits;
@@ -302,9 +312,9 @@ Formula buildConstraint(vector<Formula>& ps, vector<Int>& Cs, vector<int>& base,
 
     vector<int> lo_digs;
     vector<int> hi_digs;
-    if (lo != Int_MIN)
+    if (lo != Coef<T>::min())
         convert(lo, base, lo_digs);
-    if (hi != Int_MAX)
+    if (hi != Coef<T>::max())
         convert(hi+1, base, hi_digs);   // (+1 because we will change '<= x' to '!(... >= x+1)'
 
 
@@ -314,9 +324,9 @@ Formula buildConstraint(vector<Formula>& ps, vector<Int>& Cs, vector<int>& base,
         pf(" %d", digits[i].size());
     pf("\n");
 
-    if (lo != Int_MIN){
+    if (lo != Coef<T>::min()){
         pf("lo=%d :", lo); for (int i = 0; i < lo_digs.size(); i++) pf(" %d", lo_digs[i]); pf("\n"); }
-    if (hi != Int_MAX){
+    if (hi != Coef<T>::max()){
         pf("hi+1=%d :", hi+1); for (int i = 0; i < hi_digs.size(); i++) pf(" %d", hi_digs[i]); pf("\n"); }
     END*/
 
@@ -326,8 +336,8 @@ Base:  (1)    8    24   480
 Num:    2    0     5     6
 */
 
-    Formula ret = ((lo == Int_MIN) ? _1_ :  lexComp(lo_digs, digits))
-                & ((hi == Int_MAX) ? _1_ : ~lexComp(hi_digs, digits));
+    Formula ret = ((lo == Coef<T>::min()) ? _1_ :  lexComp(lo_digs, digits))
+                & ((hi == Coef<T>::max()) ? _1_ : ~lexComp(hi_digs, digits));
     if (FEnv::topSize() > max_cost) throw Exception_TooBig();
     return ret;
 }
@@ -350,18 +360,17 @@ a4
 
 
 
-// Will return '_undef_' if 'cost_limit' is exceeded.
-//
-Formula buildConstraint(const Linear& c, int max_cost)
+template<class T>
+static Formula buildConstraint(const Linear& c, int max_cost)
 {
     vector<Formula>    ps;
-    vector<Int>        Cs;
+    vector<T>          Cs;
 
     for (int j = 0; j < c.size; j++)
         ps.push_back(lit2fml(c[j])),
-        Cs.push_back(c(j));
+        Cs.push_back(Coef<T>::from(c(j)));
 
-    vector<Int> dummy;
+    vector<T> dummy;
     int      cost;
     vector<int> base;
     optimizeBase(Cs, dummy, cost, base);
@@ -369,7 +378,7 @@ Formula buildConstraint(const Linear& c, int max_cost)
 
     Formula ret;
     try {
-        ret = buildConstraint(ps, Cs, base, c.lo, c.hi, max_cost);
+        ret = buildConstraint(ps, Cs, base, Coef<T>::from(c.lo), Coef<T>::from(c.hi), max_cost);
     }catch (Exception_TooBig){
         FEnv::pop();
         return _undef_;
@@ -382,3 +391,15 @@ Formula buildConstraint(const Linear& c, int max_cost)
     FEnv::keep();
     return ret;
 }
+
+
+// Will return '_undef_' if 'cost_limit' is exceeded.
+//
+Formula buildConstraint(const Linear& c, int max_cost)
+{
+    switch (coefWidth(c)){
+    case cw_Int:   return buildConstraint<int>  (c, max_cost);
+    case cw_Int64: return buildConstraint<int64>(c, max_cost);
+    default:       return buildConstraint<Int>  (c, max_cost);
+    }
+}
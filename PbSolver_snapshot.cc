@@ -0,0 +1,210 @@
+/****************************************************************************[PbSolver_snapshot.cc]
+Copyright (c) 2005-2010, Niklas Een, Niklas Sorensson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**************************************************************************************************/
+
+#include "PbSolver.h"
+#include "File.h"
+
+
+/*
+A snapshot stores the problem as it looks after parsing, normalization, unit propagation and
+probing, so that it can be solved again (e.g. with other conversion options) without redoing that
+work. The later passes of 'solve()' still run on load: some depend on the command (e.g. '-all'),
+and 'rewriteAlmostClauses()' adds variables and clauses straight to the SAT solver, which a
+snapshot doesn't hold:
+
+    magic, declared #variables + 1, declared #constraints + 1
+    #variables,   then for each variable:  length of name, name (without terminating zero)
+    okay flag
+    #units,       then for each unit:      literal
+    goal flag,    then (if set):           linear
+    #constraints, then for each:           linear
+    magic
+
+where a 'linear' is: size, literals, flags (1 = no lower bound, 2 = no upper bound, 4 = bignums),
+coefficients, lower bound (if any), upper bound (if any). Literals are written as 'toInt(p)', all
+numbers with the variable length encoding of 'putUInt()'/'putInt()' -- or, if flag 4 is set, as
+length and decimal digits (with sign).
+*/
+
+#define Snapshot_Magic "PBSNAP02"
+
+//-------------------------------------------------------------------------------------------------
+// Saving:
+
+
+static bool fitsInt64(Int val) { return val >= Int(LLONG_MIN) && val <= Int(LLONG_MAX); }
+
+static void putInt_(File& out, Int val, bool big)
+{
+    if (!big)
+        putInt(out, (int64)val);
+    else{
+        char* text = val.toString();
+        int   len  = strlen(text);
+        putUInt(out, len);
+        for (int i = 0; i < len; i++) out.putChar(text[i]);
+        delete [] text;
+    }
+}
+
+static void putLinear(File& out, const Linear& c)
+{
+    bool big = (c.lo != Int_MIN && !fitsInt64(c.lo)) || (c.hi != Int_MAX && !fitsInt64(c.hi));
+    for (int i = 0; i < c.size && !big; i++) big = !fitsInt64(c(i));
+
+    putUInt(out, c.size);
+    for (int i = 0; i < c.size; i++) putUInt(out, toInt(c[i]));
+    putUInt(out, (c.lo == Int_MIN ? 1 : 0) | (c.hi == Int_MAX ? 2 : 0) | (big ? 4 : 0));
+    for (int i = 0; i < c.size; i++) putInt_(out, c(i), big);
+    if (c.lo != Int_MIN) putInt_(out, c.lo, big);
+    if (c.hi != Int_MAX) putInt_(out, c.hi, big);
+}
+
+void PbSolver::saveSnapshot(cchar* filename)
+{
+    File out(filename, "wb");
+    if (out.null()){
+        reportf("ERROR! Could not open snapshot file for writing: %s\n", filename);
+        return; }
+
+    for (cchar* p = Snapshot_Magic; *p != 0; p++) out.putChar(*p);
+    putUInt(out, declared_n_vars + 1);
+    putUInt(out, declared_n_constrs + 1);
+
+    putUInt(out, index2name.size());
+    for (size_t i = 0; i < index2name.size(); i++){
+        int len = strlen(index2name[i]);
+        putUInt(out, len);
+        for (int j = 0; j < len; j++) out.putChar(index2name[i][j]); }
+
+    putUInt(out, okay());
+    putUInt(out, trail.size());
+    for (size_t i = 0; i < trail.size(); i++) putUInt(out, toInt(trail[i]));
+
+    putUInt(out, goal != NULL);
+    if (goal != NULL) putLinear(out, *goal);
+
+    int n_constrs = 0;
+    for (size_t i = 0; i < constrs.size(); i++) if (constrs[i] != LRef_Undef) n_constrs++;
+    putUInt(out, n_constrs);
+    for (size_t i = 0; i < constrs.size(); i++)
+        if (constrs[i] != LRef_Undef) putLinear(out, constr_mem[constrs[i]]);
+
+    for (cchar* p = Snapshot_Magic; *p != 0; p++) out.putChar(*p);
+
+    if (opt_verbosity >= 1)
+        reportf("Saved snapshot: %d variables, %d units, %d constraints\n", (int)index2name.size(), (int)trail.size(), n_constrs);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Loading:
+
+
+static bool getMagic(MemReader& in)
+{
+    cchar* magic = in.getChars(strlen(Snapshot_Magic));
+    return magic != NULL && strncmp(magic, Snapshot_Magic, strlen(Snapshot_Magic)) == 0;
+}
+
+static Int getInt_(MemReader& in, bool big, vector<char>& tmp)
+{
+    if (!big) return Int(getInt(in));
+    uint64 len  = getUInt(in);
+    cchar* text = in.getChars(len);
+    if (text == NULL) return Int(0);
+    tmp.assign(text, text + len);
+    tmp.push_back(0);
+    return Int(&tmp[0]);
+}
+
+// Reads a linear into 'ps', 'Cs', 'lo', 'hi'. Returns FALSE if the data is invalid.
+static bool getLinear(MemReader& in, int n_vars, vector<Lit>& ps, vector<Int>& Cs, Int& lo, Int& hi)
+{
+    uint64 size = getUInt(in);
+    if (size > (uint64)n_vars * 2) return false;
+    ps.clear();
+    Cs.clear();
+    for (uint64 i = 0; i < size; i++){
+        uint64 lit = getUInt(in);
+        if (lit >= (uint64)n_vars * 2) return false;
+        ps.push_back(Minisat::toLit((int)lit)); }
+    uint64 flags = getUInt(in);
+    bool   big   = flags & 4;
+    vector<char> tmp;
+    for (uint64 i = 0; i < size; i++)
+        Cs.push_back(getInt_(in, big, tmp));
+    lo = (flags & 1) ? Int_MIN : getInt_(in, big, tmp);
+    hi = (flags & 2) ? Int_MAX : getInt_(in, big, tmp);
+    return !in.eof();
+}
+
+bool PbSolver::loadSnapshot(cchar* filename)
+{
+    assert(nVars() == 0);
+    MappedFile file(filename);
+    if (file.null()) return false;
+    MemReader in(file.data(), file.size());
+    if (!getMagic(in)) return false;
+
+    int declared_vars    = (int)getUInt(in) - 1;
+    int declared_constrs = (int)getUInt(in) - 1;
+    allocConstrs(declared_vars, declared_constrs);
+
+    uint64 n_vars = getUInt(in);
+    if (n_vars > file.size()) return false;
+    vector<char> name;
+    for (uint64 i = 0; i < n_vars; i++){
+        uint64 len = getUInt(in);
+        cchar* text = in.getChars(len);
+        if (text == NULL || len == 0) return false;
+        name.assign(text, text + len);
+        name.push_back(0);
+        if (getVar(&name[0]) != (int)i) return false;      // (duplicate name)
+    }
+
+    bool ok = getUInt(in) != 0;
+    uint64 n_units = getUInt(in);
+    if (n_units > n_vars) return false;
+    for (uint64 i = 0; i < n_units; i++){
+        uint64 lit = getUInt(in);
+        if (lit >= n_vars * 2) return false;
+        addUnit(Minisat::toLit((int)lit)); }
+    if (!ok) sat_solver.addEmptyClause();
+    propQ_head = trail.size();      // (constraints were propagated before saving)
+
+    vector<Lit> ps;
+    vector<Int> Cs;
+    Int         lo, hi;
+    if (getUInt(in) != 0){
+        if (!getLinear(in, n_vars, ps, Cs, lo, hi)) return false;
+        goal = Linear_new(ps, Cs, lo, hi); }
+
+    uint64 n_constrs = getUInt(in);
+    if (n_constrs > file.size()) return false;
+    for (uint64 i = 0; i < n_constrs; i++){
+        if (!getLinear(in, n_vars, ps, Cs, lo, hi)) return false;
+        storePb(ps, Cs, lo, hi); }
+
+    if (!getMagic(in)) return false;
+
+    if (opt_verbosity >= 1)
+        reportf("Loaded snapshot: %d variables, %d units, %d constraints\n", (int)n_vars, (int)n_units, (int)n_constrs);
+    return true;
+}
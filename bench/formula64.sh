@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Compares the default build with the 64-bit formula handles of 'MINISATP_FML64=1' on a generated
+# instance whose constraints all become adders or sorters: N constraints of K terms with
+# coefficients up to 10^5 and mixed signs, over V variables (satisfiable by a planted solution).
+# The run ends after the CNF export, so the time is that of parsing, preprocessing and encoding.
+#
+#   usage: bench/formula64.sh [#constraints] [revision]
+#
+# Make variables such as MINISAT_INCLUDE and MINISAT_LIB are taken from 'config.mk' or from the
+# environment. Reports the best user time of RUNS runs (default 3) for each build, and the peak
+# memory if GNU time is installed as '/usr/bin/time'.
+
+N=${1:-200}
+REV=${2:-HEAD}
+RUNS=${RUNS:-3}
+V=$((N * 10))
+K=40
+
+REPO=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+build() {   # <MINISATP_FML64> <directory>
+    mkdir -p "$2"
+    git -C "$REPO" archive "$REV" | tar -x -C "$2" || exit 1
+    [ -f "$REPO/config.mk" ] && cp "$REPO/config.mk" "$2/"
+    make -s -C "$2" r BUILD_DIR=build MINISATP_FML64=$1 > "$2.log" 2>&1 || { echo "Build failed, see:"; cat "$2.log"; exit 1; }
+}
+
+awk -v N=$N -v V=$V -v K=$K 'BEGIN{
+    srand(1)
+    for (v = 1; v <= V; v++) val[v] = rand() < 0.5
+    printf "* #variable= %d #constraint= %d\n", V, N
+    for (c = 0; c < N; c++){
+        s = 0
+        for (j = 0; j < K; j++){
+            v = 1 + int(rand() * V)
+            a = 1 + int(rand() * 100000); if (rand() < 0.5) a = -a; if (val[v]) s += a
+            printf "%+d*x%d ", a, v }
+        printf ">= %d ;\n", s } }' > "$TMP/enc.opb"
+echo "Generated $N constraints of $K terms over $V variables."
+
+build 0 "$TMP/fml32"
+build 1 "$TMP/fml64"
+
+TIMEFORMAT=%U
+for fml in 32 64; do
+    bin="$TMP/fml$fml/build/release/bin/minisatp"
+    best=
+    for ((i = 0; i < RUNS; i++)); do
+        t=$( { time "$bin" -cnf="$TMP/out$fml.cnf" "$TMP/enc.opb" > /dev/null 2>&1; } 2>&1 )
+        if [ -z "$best" ] || awk "BEGIN{exit !($t < $best)}"; then best=$t; fi
+    done
+    mem=
+    if [ -x /usr/bin/time ]; then
+        kb=$(/usr/bin/time -f %M "$bin" -cnf="$TMP/out$fml.cnf" "$TMP/enc.opb" 2>&1 > /dev/null | tail -1)
+        mem=$(awk "BEGIN{printf \"   %.1f MB\", $kb / 1024}")
+    fi
+    printf "FML64=%d:  %6.2f s%s\n" $((fml == 64)) "$best" "$mem"
+done
+cmp -s "$TMP/out32.cnf" "$TMP/out64.cnf" && echo "Both builds wrote the same CNF." || echo "The CNFs differ!"
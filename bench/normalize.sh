@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# Times parsing, normalization and CNF export of N generated small constraints with the
+# binaries of two revisions -- by default the ones before and after the epoch table of
+# 'normalizePb()' (commit 988bb45). Each constraint has 3-6 terms with mixed signs and a repeated
+# variable, so every one of them goes through the grouping of x/~x.
+#
+#   usage: bench/normalize.sh [#constraints] [old revision] [new revision]
+#
+# Make variables such as MINISAT_INCLUDE and MINISAT_LIB are taken from 'config.mk' or from the
+# environment. Reports the best user time of RUNS runs (default 3) for each revision.
+
+N=${1:-400000}
+OLD=${2:-988bb45^}
+NEW=${3:-988bb45}
+RUNS=${RUNS:-3}
+
+REPO=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+build() {   # <revision> <directory>
+    mkdir -p "$2"
+    git -C "$REPO" archive "$1" | tar -x -C "$2" || exit 1
+    [ -f "$REPO/config.mk" ] && cp "$REPO/config.mk" "$2/"
+    make -s -C "$2" r BUILD_DIR=build > "$2.log" 2>&1 || { echo "Build of $1 failed, see:"; cat "$2.log"; exit 1; }
+}
+
+awk -v N=$N -v V=$((N / 4)) 'BEGIN{
+    srand(1)
+    for (v = 1; v <= V; v++) val[v] = rand() < 0.5      # (planted solution, keeps it satisfiable)
+    printf "* #variable= %d #constraint= %d\n", V, N
+    for (c = 0; c < N; c++){
+        k = 3 + int(rand() * 4); x = 1 + int(rand() * V); s = 0
+        for (j = 0; j < k; j++){
+            v = (j == 0 || j == k-1) ? x : 1 + int(rand() * V)
+            a = 1 + int(rand() * 9); if (rand() < 0.5) a = -a; if (val[v]) s += a
+            printf "%+d*x%d ", a, v }
+        printf ">= %d ;\n", s - int(rand() * 3) } }' > "$TMP/small.opb"
+echo "Generated $N constraints ($(du -h "$TMP/small.opb" | cut -f1))."
+
+build "$OLD" "$TMP/old"
+build "$NEW" "$TMP/new"
+
+TIMEFORMAT=%U
+for which in old new; do
+    best=
+    for ((i = 0; i < RUNS; i++)); do
+        t=$( { time "$TMP/$which/build/release/bin/minisatp" -cnf="$TMP/out.cnf" "$TMP/small.opb" > /dev/null 2>&1; } 2>&1 )
+        if [ -z "$best" ] || awk "BEGIN{exit !($t < $best)}"; then best=$t; fi
+    done
+    rev=$OLD; [ $which = new ] && rev=$NEW
+    printf "%-12s %6.2f s\n" "$rev:" "$best"
+done